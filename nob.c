@@ -3,32 +3,204 @@
 
 // Some folder paths that we use throughout the build process.
 #define BUILD_FOLDER "build/"
+#define OBJ_FOLDER   BUILD_FOLDER"obj/"
 #define SRC_FOLDER   "src/"
 
+// Every translation unit is compiled on its own into OBJ_FOLDER and then linked into one or more
+// executables. A target lists its sources by name (without the .c) and the extra libraries it needs.
+typedef struct {
+    const char *name;
+    const char **sources;
+    size_t sources_count;
+    const char **libs;
+    size_t libs_count;
+} Target;
+
+#define TARGET(target_name, srcs, lbs) { \
+    .name = (target_name), \
+    .sources = (srcs), .sources_count = NOB_ARRAY_LEN(srcs), \
+    .libs = (lbs), .libs_count = NOB_ARRAY_LEN(lbs), \
+}
+
+static const char *raylib_libs[] = { "-lraylib", "-lGL", "-lm", "-lpthread", "-ldl", "-lrt", "-lX11" };
+
+static const char *headless_libs[] = { "-lm", "-lpthread" };
+
+static const char *main_sources[] = { "main", "engine", "solver", "hint", "save", "dealdb", "estimate", "stats", "pacing", "prefetch", "platform" };
+static const char *bench_sources[] = { "bench", "engine", "solver", "pool", "platform" };
+static const char *classify_sources[] = { "classify", "engine", "solver", "dealdb", "platform" };
+static const char *bot_sources[] = { "bot", "engine", "platform" };
+static const char *server_sources[] = { "server", "engine", "pool", "platform" };
+static const char *loadgen_sources[] = { "loadgen", "engine", "platform" };
+
+static Target targets[] = {
+    TARGET("main", main_sources, raylib_libs),
+    TARGET("bench", bench_sources, headless_libs),
+    TARGET("classify", classify_sources, headless_libs),
+    TARGET("bot", bot_sources, headless_libs),
+    TARGET("server", server_sources, headless_libs),
+    TARGET("loadgen", loadgen_sources, headless_libs),
+};
+
+// Appends the prerequisites listed in a `-MMD` dependency file to deps. The first rule of the file is
+// `obj: src hdr1 hdr2 ...`, possibly split with backslash continuations; the phony rules that `-MP`
+// adds after it are skipped.
+static bool read_deps(const char *dep_path, Nob_File_Paths *deps)
+{
+    Nob_String_Builder sb = {0};
+    if (!nob_read_entire_file(dep_path, &sb)) return false;
+
+    Nob_String_View sv = nob_sb_to_sv(sb);
+    bool seen_target = false;
+    while (sv.count > 0) {
+        sv = nob_sv_trim_left(sv);
+        size_t n = 0;
+        while (n < sv.count && !isspace((unsigned char)sv.data[n])) n += 1;
+        Nob_String_View tok = nob_sv_chop_left(&sv, n);
+        if (tok.count == 0 || nob_sv_eq(tok, nob_sv_from_cstr("\\"))) continue;
+        if (tok.data[tok.count-1] == ':') {
+            if (seen_target) break;
+            seen_target = true;
+            continue;
+        }
+        nob_da_append(deps, nob_temp_sv_to_cstr(tok));
+    }
+
+    nob_sb_free(sb);
+    return true;
+}
+
+// An object is stale when it is missing, has no dependency file yet, or any source or header it was
+// compiled from is newer than it. Headers that have since been deleted force a rebuild too.
+static bool object_is_stale(const char *obj_path, const char *dep_path, const char *src_path)
+{
+    if (!nob_file_exists(obj_path) || !nob_file_exists(dep_path)) return true;
+
+    Nob_File_Paths deps = {0};
+    nob_da_append(&deps, src_path);
+    if (!read_deps(dep_path, &deps)) {
+        nob_da_free(deps);
+        return true;
+    }
+
+    bool stale = false;
+    for (size_t i = 0; i < deps.count && !stale; ++i) {
+        if (nob_file_exists(deps.items[i]) != 1) stale = true;
+    }
+    if (!stale) stale = nob_needs_rebuild(obj_path, deps.items, deps.count) != 0;
+
+    nob_da_free(deps);
+    return stale;
+}
+
+static bool target_selected(const Target *t, const char **names, size_t names_count)
+{
+    if (names_count == 0) return true;
+    for (size_t i = 0; i < names_count; ++i) {
+        if (strcmp(t->name, names[i]) == 0) return true;
+    }
+    return false;
+}
+
+static bool source_compiled(const char *source, Nob_File_Paths *compiled)
+{
+    for (size_t i = 0; i < compiled->count; ++i) {
+        if (strcmp(compiled->items[i], source) == 0) return true;
+    }
+    nob_da_append(compiled, source);
+    return false;
+}
+
 int main(int argc, char **argv)
 {
     NOB_GO_REBUILD_URSELF(argc, argv);
 
     if (!nob_mkdir_if_not_exists(BUILD_FOLDER)) return 1;
+    if (!nob_mkdir_if_not_exists(OBJ_FOLDER)) return 1;
 
     const char* program = nob_shift(argv, argc);
+    NOB_UNUSED(program);
+
+    // `./nob` builds everything, `./nob <target>...` only the named targets and `./nob run` builds
+    // and starts the game.
+    bool run = false;
+    Nob_File_Paths selected = {0};
+    while (argc > 0) {
+        const char* param = nob_shift(argv, argc);
+        if (strcmp(param, "run") == 0) {
+            run = true;
+            nob_da_append(&selected, "main");
+        } else {
+            nob_da_append(&selected, param);
+        }
+    }
+
+    for (size_t i = 0; i < selected.count; ++i) {
+        bool known = false;
+        for (size_t t = 0; t < NOB_ARRAY_LEN(targets); ++t) {
+            if (strcmp(targets[t].name, selected.items[i]) == 0) known = true;
+        }
+        if (!known) {
+            nob_log(NOB_ERROR, "unknown target `%s`", selected.items[i]);
+            return 1;
+        }
+    }
+
+    size_t jobs = 1;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu > 0) jobs = (size_t)ncpu;
 
     // The working horse of nob is the Nob_Cmd structure. It's a Dynamic Array of strings which represent
     // command line that you want to execute.
     Nob_Cmd cmd = {0};
+    Nob_Procs procs = {0};
+    Nob_File_Paths compiled = {0};
+
+    // Compile every stale object of the selected targets in parallel. Sources shared between targets are
+    // only compiled once.
+    for (size_t t = 0; t < NOB_ARRAY_LEN(targets); ++t) {
+        if (!target_selected(&targets[t], selected.items, selected.count)) continue;
+        for (size_t s = 0; s < targets[t].sources_count; ++s) {
+            const char *source = targets[t].sources[s];
+            if (source_compiled(source, &compiled)) continue;
 
-    nob_cmd_append(&cmd, "cc", "-ggdb", "-Wall", "-Wextra", "-o", BUILD_FOLDER"main", SRC_FOLDER"main.c");
-    nob_cmd_append(&cmd, "-lraylib", "-lGL", "-lm", "-lpthread", "-ldl", "-lrt", "-lX11");
+            const char *src_path = nob_temp_sprintf(SRC_FOLDER"%s.c", source);
+            const char *obj_path = nob_temp_sprintf(OBJ_FOLDER"%s.o", source);
+            const char *dep_path = nob_temp_sprintf(OBJ_FOLDER"%s.d", source);
+            if (!object_is_stale(obj_path, dep_path, src_path)) continue;
+
+            nob_cmd_append(&cmd, "cc", "-ggdb", "-O2", "-Wall", "-Wextra", "-MMD", "-MP");
+            nob_cmd_append(&cmd, "-c", "-o", obj_path, src_path);
+            if (!nob_procs_append_with_flush(&procs, nob_cmd_run_async_and_reset(&cmd), jobs)) return 1;
+        }
+    }
+    if (!nob_procs_wait_and_reset(&procs)) return 1;
+
+    // Link the executables whose objects changed, also in parallel.
+    for (size_t t = 0; t < NOB_ARRAY_LEN(targets); ++t) {
+        Target *target = &targets[t];
+        if (!target_selected(target, selected.items, selected.count)) continue;
+
+        const char *exe_path = nob_temp_sprintf(BUILD_FOLDER"%s", target->name);
+        Nob_File_Paths objs = {0};
+        for (size_t s = 0; s < target->sources_count; ++s) {
+            nob_da_append(&objs, nob_temp_sprintf(OBJ_FOLDER"%s.o", target->sources[s]));
+        }
+        int rebuild = nob_needs_rebuild(exe_path, objs.items, objs.count);
+        if (rebuild < 0) return 1;
+        if (rebuild) {
+            nob_cmd_append(&cmd, "cc", "-ggdb", "-o", exe_path);
+            nob_da_append_many(&cmd, objs.items, objs.count);
+            nob_da_append_many(&cmd, target->libs, target->libs_count);
+            if (!nob_procs_append_with_flush(&procs, nob_cmd_run_async_and_reset(&cmd), jobs)) return 1;
+        }
+        nob_da_free(objs);
+    }
+    if (!nob_procs_wait_and_reset(&procs)) return 1;
 
-    // nob_cmd_run_sync_and_reset() resets the cmd for you automatically
-    if (!nob_cmd_run_sync_and_reset(&cmd)) return 1;
-    
-    if (argc > 0) {
-      const char* param = nob_shift(argv, argc);
-      if (strcmp(param, "run") == 0) {
-        nob_cmd_append(&cmd, "./"BUILD_FOLDER"/main");
+    if (run) {
+        nob_cmd_append(&cmd, "./"BUILD_FOLDER"main");
         if (!nob_cmd_run_sync_and_reset(&cmd)) return 1;
-      }
     }
 
     return 0;
@@ -0,0 +1,409 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <string.h>
+
+#define NOB_IMPLEMENTATION
+#include "../nob.h"
+
+#include "engine.h"
+#include "pool.h"
+#include "solver.h"
+#include "platform.h"
+
+// Headless micro benchmarks for the engine. `./build/bench [name]` runs one of them, no argument
+// runs them all. Some of them also check the engine as they go; the run exits with 1 when any
+// check fails.
+
+static void RandomDeal(Board *board, uint64_t *rng, VariantKind variant, size_t drawCount) {
+  CardId order[MAX_CARDS];
+  size_t count = FillShoe(order, variants[variant].decks);
+  ShuffleCardIds(order, count, rng);
+  DealBoard(board, variant, order, count, drawCount);
+}
+
+#define BENCH_POSITIONS 1024
+#define BENCH_PLIES 60
+
+// Collects positions from random playouts first so that only move generation itself is timed.
+static void CollectPositions(Board *positions, VariantKind variant, uint64_t *rng) {
+  Move moves[MAX_MOVES];
+  size_t collected = 0;
+  while (collected < BENCH_POSITIONS) {
+    Board board;
+    RandomDeal(&board, rng, variant, collected % 2 ? 3 : 1);
+    for (size_t ply = 0; ply < BENCH_PLIES && collected < BENCH_POSITIONS; ++ply) {
+      positions[collected++] = board;
+      size_t n = GenerateMoves(&board, moves);
+      if (n == 0) break;
+      ApplyMove(&board, moves[NextRandom(rng) % n]);
+    }
+  }
+}
+
+// Seconds per position for `generate` over all the positions; `total` collects the move count.
+static double TimeGenerator(size_t (*generate)(const Board *, Move *), const Board *positions, size_t rounds, size_t *total) {
+  Move moves[MAX_MOVES];
+  double start = NowSeconds();
+  for (size_t r = 0; r < rounds; ++r) {
+    for (size_t p = 0; p < BENCH_POSITIONS; ++p) *total += generate(&positions[p], moves);
+  }
+  return (NowSeconds() - start)/(rounds*BENCH_POSITIONS);
+}
+
+static bool BenchMoveGen(void) {
+  static Board positions[BENCH_POSITIONS];
+  uint64_t rng = 0xC0FFEE;
+  CollectPositions(positions, VARIANT_KLONDIKE, &rng);
+  size_t total = 0;
+  size_t rounds = 2000;
+  double perPosition = TimeGenerator(GenerateMoves, positions, rounds, &total);
+  size_t calls = rounds*BENCH_POSITIONS;
+  printf("movegen: %zu positions, %.1f ns/position, %.2f moves/position\n",
+         calls, perPosition*1e9, (double)total/calls);
+  return true;
+}
+
+// Move generation in every variant: the copy of the generator specialized for the variant
+// against the generic one that reads the rules at run time. Both must agree move for move.
+static bool BenchVariants(void) {
+  static Board positions[BENCH_POSITIONS];
+  Move moves[MAX_MOVES];
+  Move check[MAX_MOVES];
+  for (size_t v = 0; v < VARIANT_COUNT; ++v) {
+    uint64_t rng = 0xC0FFEE + v;
+    CollectPositions(positions, v, &rng);
+    for (size_t p = 0; p < BENCH_POSITIONS; ++p) {
+      size_t n = GenerateMoves(&positions[p], moves);
+      if (GenerateMovesGeneric(&positions[p], check) != n || memcmp(moves, check, n*sizeof(Move)) != 0) {
+        nob_log(NOB_ERROR, "%s: specialized and generic move generators disagree", variants[v].name);
+        return false;
+      }
+    }
+    size_t total = 0;
+    size_t rounds = 1000;
+    double specialized = TimeGenerator(GenerateMoves, positions, rounds, &total);
+    double generic = TimeGenerator(GenerateMovesGeneric, positions, rounds, &total);
+    printf("variants: %-16s %6.1f ns specialized, %6.1f ns generic, %.2fx, %.2f moves/position\n",
+           variants[v].name, specialized*1e9, generic*1e9, generic/specialized, (double)total/(2*rounds*BENCH_POSITIONS));
+  }
+  return true;
+}
+
+#define BATCH_ROUNDS 200
+
+// Which files of 1024 Klondike positions take each of the 52 cards: walking every board's tops
+// with the build rule, then the same answer from gathered top keys, one compare per file and with
+// SIMD. All three must agree.
+static bool BenchBatch(void) {
+  static Board positions[BENCH_POSITIONS];
+  static uint8_t keys[BENCH_POSITIONS*TOP_KEY_STRIDE];
+  static uint16_t masks[CARDS_PER_DECK][BENCH_POSITIONS];
+  static uint16_t check[BENCH_POSITIONS];
+  uint64_t rng = 0xBA7C4;
+  CollectPositions(positions, VARIANT_KLONDIKE, &rng);
+
+  double start = NowSeconds();
+  for (size_t r = 0; r < BATCH_ROUNDS; ++r) {
+    for (CardId card = 0; card < CARDS_PER_DECK; ++card) {
+      for (size_t b = 0; b < BENCH_POSITIONS; ++b) {
+        uint16_t mask = 0;
+        for (size_t t = 0; t < variants[VARIANT_KLONDIKE].tableau; ++t) {
+          const Pile *pile = &positions[b].piles[PILE_TABLEAU + t];
+          if (pile->count == pile->hidden) continue;
+          CardId top = pile->cards[pile->count-1];
+          if (CardIdValue(top) == CardIdValue(card) + 1 && CardIdIsRed(top) != CardIdIsRed(card)) mask |= 1u << t;
+        }
+        masks[card][b] = mask;
+      }
+    }
+  }
+  double branching = NowSeconds() - start;
+
+  start = NowSeconds();
+  for (size_t r = 0; r < BATCH_ROUNDS; ++r) GatherTopKeys(positions, BENCH_POSITIONS, keys);
+  double gather = NowSeconds() - start;
+
+  void (*match[])(const uint8_t *, size_t, uint8_t, uint16_t *) = { MatchTopKeysScalar, MatchTopKeys };
+  double seconds[NOB_ARRAY_LEN(match)];
+  for (size_t m = 0; m < NOB_ARRAY_LEN(match); ++m) {
+    start = NowSeconds();
+    for (size_t r = 0; r < BATCH_ROUNDS; ++r) {
+      for (CardId card = 0; card < CARDS_PER_DECK; ++card) {
+        match[m](keys, BENCH_POSITIONS, CardBuildKey(&positions[0], card), check);
+      }
+    }
+    seconds[m] = NowSeconds() - start;
+    for (CardId card = 0; card < CARDS_PER_DECK; ++card) {
+      match[m](keys, BENCH_POSITIONS, CardBuildKey(&positions[0], card), check);
+      if (memcmp(check, masks[card], sizeof(check)) != 0) {
+        nob_log(NOB_ERROR, "batch: matching top keys disagrees with the build rule");
+        return false;
+      }
+    }
+  }
+
+  double queries = (double)BATCH_ROUNDS*CARDS_PER_DECK*BENCH_POSITIONS;
+  printf("batch: %.2f ns/board branching, %.2f ns/board scalar, %.2f ns/board %s (%.1fx), gather %.1f ns/board\n",
+         branching/queries*1e9, seconds[0]/queries*1e9, seconds[1]/queries*1e9, MatchTopKeysPath(),
+         branching/seconds[1], gather/(BATCH_ROUNDS*BENCH_POSITIONS)*1e9);
+  return true;
+}
+
+#define CHECK_GAMES 200
+#define CHECK_PLIES 400
+
+// Not a timing: plays random games in every variant and checks after each move that the location
+// table and the hidden file and foundation summaries agree with the piles, and that no card was
+// lost or duplicated.
+static bool BenchLocations(void) {
+  uint64_t rng = 0x10CA7E;
+  Move moves[MAX_MOVES];
+  size_t positions = 0;
+  size_t mismatches = 0;
+  for (size_t v = 0; v < VARIANT_COUNT; ++v) {
+    size_t shoe = (size_t)variants[v].decks*CARDS_PER_DECK;
+    for (size_t g = 0; g < CHECK_GAMES; ++g) {
+      Board board;
+      RandomDeal(&board, &rng, v, g % 2 ? 3 : 1);
+      for (size_t ply = 0; ply < CHECK_PLIES; ++ply) {
+        bool seen[CARD_ID_LIMIT] = {0};
+        size_t cards = 0;
+        for (size_t p = 0; p <= PILE_WASTE; ++p) {
+          PileView view = ViewPile(&board, p);
+          for (size_t c = 0; c < view.count; ++c) {
+            CardLocation where = LocateCard(&board, view.cards[c]);
+            if (where.pile != p || where.index != c || seen[view.cards[c]]) mismatches++;
+            seen[view.cards[c]] = true;
+            cards++;
+          }
+        }
+        if (cards != shoe) mismatches++;
+        for (size_t t = 0; t < MAX_TABLEAU; ++t) {
+          bool hidden = board.piles[PILE_TABLEAU + t].hidden > 0;
+          if (hidden != ((board.hiddenFiles >> t) & 1)) mismatches++;
+          // MovableFrom walks the file's run, so it checks the group start ApplyMove kept.
+          if (board.groupStarts[t] != MovableFrom(&board, PILE_TABLEAU + t)) mismatches++;
+        }
+        for (size_t f = 0; f < MAX_FOUNDATIONS; ++f) {
+          if (FoundationHeight(&board, f) != board.piles[PILE_FOUNDATION + f].count) mismatches++;
+        }
+        positions++;
+        size_t n = GenerateMoves(&board, moves);
+        if (n == 0) break;
+        ApplyMove(&board, moves[NextRandom(&rng) % n]);
+      }
+    }
+  }
+  if (mismatches > 0) nob_log(NOB_ERROR, "locations: %zu mismatches", mismatches);
+  printf("locations: %zu positions checked, %zu mismatches\n", positions, mismatches);
+  return mismatches == 0;
+}
+
+#define BENCH_SOLVE_DEALS 50
+
+// Runs the solver with the hint budget on fresh deals, drawing one and then three: how often it
+// finds a win in time and how many positions per second it gets through.
+static bool BenchSolve(void) {
+  static Solver solver;
+  static Solution solution;
+  if (!InitSolver(&solver, 18)) return false;
+  for (size_t drawCount = 1; drawCount <= 3; drawCount += 2) {
+    uint64_t rng = 0x5EED;
+    size_t results[3] = {0};
+    size_t nodes = 0;
+    double start = NowSeconds();
+    for (size_t d = 0; d < BENCH_SOLVE_DEALS; ++d) {
+      Board board;
+      RandomDeal(&board, &rng, VARIANT_KLONDIKE, drawCount);
+      SolveLimits limits = { .seconds = 0.02 };
+      results[Solve(&solver, &board, limits, &solution)]++;
+      nodes += solution.nodes;
+    }
+    double elapsed = NowSeconds() - start;
+    printf("solve: draw %zu, %d deals at 20ms, %zu won, %zu lost, %zu unknown, %.0f nodes/s\n",
+           drawCount, BENCH_SOLVE_DEALS, results[SOLVE_WON], results[SOLVE_LOST], results[SOLVE_UNKNOWN], nodes/elapsed);
+  }
+  FreeSolver(&solver);
+  return true;
+}
+
+// A card as the UI kept it before decks held their cards inline: drawing state next to the id.
+typedef struct {
+  CardId id;
+  uint8_t suit;
+  uint8_t value;
+  bool flipped;
+  float source[4];
+  float bounds[4];
+  float origin[2];
+} NestedCard;
+
+typedef struct {
+  NestedCard *items;
+  size_t count;
+  size_t capacity;
+} NestedDeck;
+
+// The game state laid out the old way, one growable heap array per pile.
+typedef struct {
+  NestedDeck piles[PILE_WASTE + 1];
+} NestedState;
+
+static void BuildNested(NestedState *state, const Board *board) {
+  *state = (NestedState) {0};
+  for (size_t p = 0; p <= PILE_WASTE; ++p) {
+    PileView view = ViewPile(board, p);
+    for (size_t c = 0; c < view.count; ++c) {
+      NestedCard card = { .id = view.cards[c], .flipped = c >= view.hidden };
+      nob_da_append(&state->piles[p], card);
+    }
+  }
+}
+
+static void CopyNested(NestedState *copy, const NestedState *state) {
+  for (size_t p = 0; p <= PILE_WASTE; ++p) {
+    const NestedDeck *deck = &state->piles[p];
+    copy->piles[p] = (NestedDeck) { .count = deck->count, .capacity = deck->capacity };
+    if (deck->capacity == 0) continue;
+    copy->piles[p].items = malloc(deck->capacity*sizeof(*deck->items));
+    memcpy(copy->piles[p].items, deck->items, deck->count*sizeof(*deck->items));
+  }
+}
+
+static void FreeNested(NestedState *state) {
+  for (size_t p = 0; p <= PILE_WASTE; ++p) free(state->piles[p].items);
+}
+
+// Makes the compiler assume `data` is read, so a copy nothing else looks at is still made.
+static inline void Escape(void *data) {
+  __asm__ volatile("" : : "r"(data) : "memory");
+}
+
+// What a search branch costs: snapshotting the packed board, applying one move to the snapshot and
+// dropping it, against only copying and freeing the same position laid out as nested heap arrays.
+// The board is one flat block, so the snapshot is a single memcpy and no piles need sharing.
+static bool BenchSnapshot(void) {
+  static Board positions[BENCH_POSITIONS];
+  static Move picks[BENCH_POSITIONS];
+  static bool playable[BENCH_POSITIONS];
+  static NestedState nested[BENCH_POSITIONS];
+  uint64_t rng = 0x5A95;
+  CollectPositions(positions, VARIANT_KLONDIKE, &rng);
+  Move moves[MAX_MOVES];
+  for (size_t p = 0; p < BENCH_POSITIONS; ++p) {
+    size_t n = GenerateMoves(&positions[p], moves);
+    playable[p] = n > 0;
+    if (n > 0) picks[p] = moves[NextRandom(&rng) % n];
+    BuildNested(&nested[p], &positions[p]);
+  }
+
+  size_t rounds = 2000;
+  double start = NowSeconds();
+  for (size_t r = 0; r < rounds; ++r) {
+    for (size_t p = 0; p < BENCH_POSITIONS; ++p) {
+      Board child = positions[p];
+      Escape(&child);
+    }
+  }
+  double copy = (NowSeconds() - start)/(rounds*BENCH_POSITIONS);
+  start = NowSeconds();
+  for (size_t r = 0; r < rounds; ++r) {
+    for (size_t p = 0; p < BENCH_POSITIONS; ++p) {
+      Board child = positions[p];
+      if (playable[p]) ApplyMove(&child, picks[p]);
+      Escape(&child);
+    }
+  }
+  double apply = (NowSeconds() - start)/(rounds*BENCH_POSITIONS);
+
+  rounds = 200;
+  start = NowSeconds();
+  for (size_t r = 0; r < rounds; ++r) {
+    for (size_t p = 0; p < BENCH_POSITIONS; ++p) {
+      NestedState copy;
+      CopyNested(&copy, &nested[p]);
+      Escape(&copy);
+      FreeNested(&copy);
+    }
+  }
+  double deep = (NowSeconds() - start)/(rounds*BENCH_POSITIONS);
+  for (size_t p = 0; p < BENCH_POSITIONS; ++p) FreeNested(&nested[p]);
+
+  printf("snapshot: board of %zu bytes, copy %.1f ns, copy+apply+discard %.1f ns (%.1fM/s)\n",
+         sizeof(Board), copy*1e9, apply*1e9, 1e-6/apply);
+  printf("snapshot: nested heap piles, copy+free alone %.1f ns (%.1fM/s), %.1fx the board\n",
+         deep*1e9, 1e-6/deep, deep/apply);
+  return true;
+}
+
+#define BENCH_LIVE_SESSIONS 4096
+#define BENCH_SESSION_CHURN 2000000
+
+// Stands in for a server session: a board and the buffers of its connection.
+typedef struct {
+  Board board;
+  uint8_t buffers[2048];
+} BenchSession;
+
+// Sessions coming and going while thousands stay live: each step ends a random session and
+// starts a fresh one, taking it from a slab pool and then from malloc. The games are dealt before
+// the clock starts, so only the allocator is timed.
+static bool BenchPool(void) {
+  static BenchSession *live[BENCH_LIVE_SESSIONS];
+  for (int usePool = 1; usePool >= 0; --usePool) {
+    Pool pool;
+    InitPool(&pool, sizeof(BenchSession), 1024);
+    uint64_t rng = 0x9001;
+    for (size_t s = 0; s < BENCH_LIVE_SESSIONS; ++s) {
+      live[s] = usePool ? TakeSlot(&pool) : malloc(sizeof(BenchSession));
+      DealSeed(&live[s]->board, VARIANT_KLONDIKE, s, 1);
+    }
+    double start = NowSeconds();
+    for (size_t c = 0; c < BENCH_SESSION_CHURN; ++c) {
+      size_t s = NextRandom(&rng) % BENCH_LIVE_SESSIONS;
+      if (usePool) GiveSlot(&pool, live[s]); else free(live[s]);
+      live[s] = usePool ? TakeSlot(&pool) : malloc(sizeof(BenchSession));
+      live[s]->board.variant = VARIANT_KLONDIKE;
+    }
+    double elapsed = NowSeconds() - start;
+    printf("pool: %s, %d live sessions, %.1f ns per session ended and started\n",
+           usePool ? "slab pool" : "malloc", BENCH_LIVE_SESSIONS, elapsed/BENCH_SESSION_CHURN*1e9);
+    for (size_t s = 0; s < BENCH_LIVE_SESSIONS; ++s) {
+      if (usePool) GiveSlot(&pool, live[s]); else free(live[s]);
+    }
+    FreePool(&pool);
+  }
+  return true;
+}
+
+// A bench returns false when a check it makes fails, so the run can fail a build.
+typedef struct {
+  const char *name;
+  bool (*run)(void);
+} Bench;
+
+static Bench benches[] = {
+  { "movegen", BenchMoveGen },
+  { "variants", BenchVariants },
+  { "solve", BenchSolve },
+  { "locations", BenchLocations },
+  { "batch", BenchBatch },
+  { "pool", BenchPool },
+  { "snapshot", BenchSnapshot },
+};
+
+int main(int argc, char **argv) {
+  const char *only = argc > 1 ? argv[1] : NULL;
+  bool found = false;
+  bool failed = false;
+  for (size_t b = 0; b < NOB_ARRAY_LEN(benches); ++b) {
+    if (only && strcmp(only, benches[b].name) != 0) continue;
+    if (!benches[b].run()) failed = true;
+    found = true;
+  }
+  if (!found) {
+    nob_log(NOB_ERROR, "Unknown benchmark %s", only);
+    return 1;
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,347 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define NOB_IMPLEMENTATION
+#include "../nob.h"
+
+#include "engine.h"
+#include "platform.h"
+
+// Lets programs outside the game play it over stdin and stdout:
+//
+//   ./build/bot [games] [batch] [variant] [draw count]   plays games against a bot on stdin/stdout
+//   ./build/bot random                                   is a bot that plays random moves
+//   ./build/bot bench [games] [batch] [variant] [draw]   times the two against each other over pipes
+//
+// The protocol is line based text. For every game it starts the engine writes
+//
+//   game <slot> <variant> <draw count>
+//
+// and for every position it wants a move in
+//
+//   state <slot> <ply>
+//   pile <pile> <count> <hidden> <face-up cards as two hex digits each>   (every pile in play)
+//   moves <n> <kind>.<from>.<to>.<count> ...
+//   .
+//
+// to which the bot answers with the index of the move it picks on a line of its own. Finished
+// games are reported as `over <slot> <won> <plies>` and `quit` ends the session. Up to `batch`
+// games are played at once: the states of all of them go out in one write and the answers are read
+// back in the same order, so a bot pays for one round trip per batch instead of per move. Nothing
+// is allocated per move; both sides work in fixed buffers.
+
+#define BOT_MAX_BATCH 256
+#define BOT_MAX_PLIES 1000
+// Room for the longest state: every pile full and every move listed.
+#define BOT_STATE_SIZE (PILE_COUNT*(16 + 2*PILE_CAPACITY) + MAX_MOVES*16 + 64)
+
+typedef struct {
+  int fd;
+  char *data;
+  size_t count;
+} Output;
+
+static bool Flush(Output *out) {
+  bool ok = WriteAll(out->fd, out->data, out->count);
+  out->count = 0;
+  return ok;
+}
+
+static void PutText(Output *out, const char *text) {
+  size_t n = strlen(text);
+  memcpy(out->data + out->count, text, n);
+  out->count += n;
+}
+
+static void PutUint(Output *out, size_t value) {
+  char digits[20];
+  size_t n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  while (n > 0) out->data[out->count++] = digits[--n];
+}
+
+static void PutChar(Output *out, char c) {
+  out->data[out->count++] = c;
+}
+
+static void PutHex(Output *out, uint8_t byte) {
+  static const char hex[] = "0123456789abcdef";
+  out->data[out->count++] = hex[byte >> 4];
+  out->data[out->count++] = hex[byte & 15];
+}
+
+typedef struct {
+  int fd;
+  char data[1 << 16];
+  size_t start;
+  size_t end;
+} Input;
+
+// Points `line` at the next line, without its newline, inside the buffer. False at end of input.
+// `before` is flushed first whenever the buffer runs dry, so nothing written is left waiting on a
+// read that needs it answered.
+static bool ReadLine(Input *in, Output *before, char **line) {
+  for (;;) {
+    char *newline = memchr(in->data + in->start, '\n', in->end - in->start);
+    if (newline) {
+      *newline = '\0';
+      *line = in->data + in->start;
+      in->start = newline + 1 - in->data;
+      return true;
+    }
+    if (in->start > 0) {
+      memmove(in->data, in->data + in->start, in->end - in->start);
+      in->end -= in->start;
+      in->start = 0;
+    }
+    if (in->end == sizeof(in->data)) return false;
+    if (before && before->count > 0 && !Flush(before)) return false;
+    ssize_t n = read(in->fd, in->data + in->end, sizeof(in->data) - in->end);
+    if (n <= 0) return false;
+    in->end += n;
+  }
+}
+
+typedef struct {
+  Board board;
+  Move moves[MAX_MOVES];
+  size_t moveCount;
+  size_t plies;
+  bool active;
+} Slot;
+
+typedef struct {
+  VariantKind variant;
+  size_t drawCount;
+  size_t games;
+  size_t batch;
+  size_t started;
+  size_t finished;
+  size_t won;
+  size_t plies;
+  uint64_t random;
+  Slot slots[BOT_MAX_BATCH];
+} Session;
+
+static bool StartGame(Session *session, Output *out, size_t s) {
+  Slot *slot = &session->slots[s];
+  if (!DealSeed(&slot->board, session->variant, NextRandom(&session->random), session->drawCount)) return false;
+  slot->plies = 0;
+  slot->active = true;
+  session->started++;
+  PutText(out, "game ");
+  PutUint(out, s);
+  PutChar(out, ' ');
+  PutUint(out, session->variant);
+  PutChar(out, ' ');
+  PutUint(out, slot->board.drawCount);
+  PutChar(out, '\n');
+  return true;
+}
+
+static bool EndGame(Session *session, Output *out, size_t s, bool won) {
+  Slot *slot = &session->slots[s];
+  slot->active = false;
+  session->finished++;
+  session->won += won;
+  session->plies += slot->plies;
+  PutText(out, "over ");
+  PutUint(out, s);
+  PutText(out, won ? " 1 " : " 0 ");
+  PutUint(out, slot->plies);
+  PutChar(out, '\n');
+  return session->started >= session->games || StartGame(session, out, s);
+}
+
+static void PutState(Output *out, size_t s, Slot *slot) {
+  const Board *board = &slot->board;
+  const Variant *variant = BoardVariant(board);
+  PutText(out, "state ");
+  PutUint(out, s);
+  PutChar(out, ' ');
+  PutUint(out, slot->plies);
+  PutChar(out, '\n');
+  for (size_t p = 0; p <= PILE_WASTE; ++p) {
+    if (IsFoundation(p) && p - PILE_FOUNDATION >= variant->foundations) continue;
+    if (IsCell(p) && p - PILE_CELL >= variant->cells) continue;
+    if (IsTableau(p) && p - PILE_TABLEAU >= variant->tableau) continue;
+    if (p >= PILE_STOCK && variant->stock == STOCK_NONE) continue;
+    PileView view = ViewPile(board, p);
+    PutText(out, "pile ");
+    PutUint(out, p);
+    PutChar(out, ' ');
+    PutUint(out, view.count);
+    PutChar(out, ' ');
+    PutUint(out, view.hidden);
+    PutChar(out, ' ');
+    for (size_t c = view.hidden; c < view.count; ++c) PutHex(out, view.cards[c]);
+    PutChar(out, '\n');
+  }
+  PutText(out, "moves ");
+  PutUint(out, slot->moveCount);
+  for (size_t m = 0; m < slot->moveCount; ++m) {
+    Move move = slot->moves[m];
+    PutChar(out, ' ');
+    PutUint(out, move.kind);
+    PutChar(out, '.');
+    PutUint(out, move.from);
+    PutChar(out, '.');
+    PutUint(out, move.to);
+    PutChar(out, '.');
+    PutUint(out, move.count);
+  }
+  PutText(out, "\n.\n");
+}
+
+// Plays the move the bot picked together with whatever the rules do on their own after it.
+static void PlayPick(Slot *slot, size_t pick) {
+  Board *board = &slot->board;
+  ApplyMove(board, slot->moves[pick]);
+  Move run;
+  while (FindCompletedRun(board, &run)) ApplyMove(board, run);
+  if (CanAutoComplete(board)) {
+    static Move rest[AUTO_COMPLETE_MAX_MOVES];
+    AutoComplete(board, rest);
+  }
+  slot->plies++;
+}
+
+static bool Serve(Session *session, Input *in, Output *out) {
+  for (size_t s = 0; s < session->batch && session->started < session->games; ++s) {
+    if (!StartGame(session, out, s)) return false;
+  }
+  while (session->finished < session->games) {
+    for (size_t s = 0; s < session->batch; ++s) {
+      Slot *slot = &session->slots[s];
+      // A game can end and a new one start in its slot before the bot is asked anything.
+      while (slot->active) {
+        slot->moveCount = GenerateMoves(&slot->board, slot->moves);
+        if (IsBoardWon(&slot->board) || slot->moveCount == 0 || slot->plies >= BOT_MAX_PLIES) {
+          if (!EndGame(session, out, s, IsBoardWon(&slot->board))) return false;
+          continue;
+        }
+        PutState(out, s, slot);
+        break;
+      }
+    }
+    if (!Flush(out)) return false;
+    for (size_t s = 0; s < session->batch; ++s) {
+      Slot *slot = &session->slots[s];
+      if (!slot->active) continue;
+      char *line;
+      if (!ReadLine(in, NULL, &line)) {
+        nob_log(NOB_ERROR, "The bot went away");
+        return false;
+      }
+      char *end;
+      size_t pick = strtoull(line, &end, 10);
+      if (end == line || pick >= slot->moveCount) {
+        nob_log(NOB_ERROR, "The bot answered `%s` to a position with %zu moves", line, slot->moveCount);
+        return false;
+      }
+      PlayPick(slot, pick);
+    }
+  }
+  PutText(out, "quit\n");
+  return Flush(out);
+}
+
+// The built-in bot: picks uniformly among the moves it is offered.
+static int RandomBot(Input *in, Output *out) {
+  uint64_t random = (uint64_t)getpid();
+  size_t moves = 0;
+  char *line;
+  while (ReadLine(in, out, &line)) {
+    if (strncmp(line, "moves ", 6) == 0) {
+      moves = strtoull(line + 6, NULL, 10);
+    } else if (strcmp(line, ".") == 0) {
+      PutUint(out, moves > 0 ? NextRandom(&random) % moves : 0);
+      PutChar(out, '\n');
+    } else if (strcmp(line, "quit") == 0) {
+      break;
+    }
+  }
+  return Flush(out) ? 0 : 1;
+}
+
+static char outputData[BOT_MAX_BATCH*BOT_STATE_SIZE];
+static Input input;
+static Session session;
+
+static bool ParseSession(Session *session, int argc, char **argv) {
+  session->games = argc > 0 ? strtoull(argv[0], NULL, 10) : 1000;
+  session->batch = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+  session->variant = argc > 2 ? strtoull(argv[2], NULL, 10) : VARIANT_KLONDIKE;
+  session->drawCount = argc > 3 ? strtoull(argv[3], NULL, 10) : 1;
+  session->random = 0xB07;
+  if (session->batch < 1 || session->batch > BOT_MAX_BATCH) {
+    nob_log(NOB_ERROR, "The batch must hold 1 to %d games", BOT_MAX_BATCH);
+    return false;
+  }
+  if (session->variant >= VARIANT_COUNT) {
+    nob_log(NOB_ERROR, "Unknown variant %d", session->variant);
+    return false;
+  }
+  if (variants[session->variant].stock == STOCK_DRAW && session->drawCount != 1 && session->drawCount != 3) {
+    nob_log(NOB_ERROR, "%s draws 1 or 3 cards, not %zu", variants[session->variant].name, session->drawCount);
+    return false;
+  }
+  return true;
+}
+
+// Runs the random bot in a child process on the other end of two pipes, so the timing covers the
+// whole protocol: formatting, the pipes and parsing on both sides.
+static int Bench(int argc, char **argv) {
+  if (!ParseSession(&session, argc, argv)) return 1;
+  int toBot[2];
+  int fromBot[2];
+  if (pipe(toBot) != 0 || pipe(fromBot) != 0) {
+    nob_log(NOB_ERROR, "Could not create pipes");
+    return 1;
+  }
+  pid_t child = fork();
+  if (child < 0) {
+    nob_log(NOB_ERROR, "Could not start the bot");
+    return 1;
+  }
+  if (child == 0) {
+    close(toBot[1]);
+    close(fromBot[0]);
+    input.fd = toBot[0];
+    Output out = { .fd = fromBot[1], .data = outputData };
+    exit(RandomBot(&input, &out));
+  }
+  close(toBot[0]);
+  close(fromBot[1]);
+  input.fd = fromBot[0];
+  Output out = { .fd = toBot[1], .data = outputData };
+  double start = NowSeconds();
+  bool ok = Serve(&session, &input, &out);
+  double elapsed = NowSeconds() - start;
+  close(toBot[1]);
+  waitpid(child, NULL, 0);
+  if (!ok) return 1;
+  printf("bot: %zu games in batches of %zu, %.0f games/s, %.0f moves/s, %zu won\n",
+         session.finished, session.batch, session.finished/elapsed, session.plies/elapsed, session.won);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const char *program = nob_shift(argv, argc);
+  NOB_UNUSED(program);
+  if (argc > 0 && strcmp(argv[0], "bench") == 0) return Bench(argc - 1, argv + 1);
+
+  input.fd = STDIN_FILENO;
+  Output out = { .fd = STDOUT_FILENO, .data = outputData };
+  if (argc > 0 && strcmp(argv[0], "random") == 0) return RandomBot(&input, &out);
+  if (!ParseSession(&session, argc, argv)) return 1;
+  if (!Serve(&session, &input, &out)) return 1;
+  fprintf(stderr, "%zu games, %zu won\n", session.finished, session.won);
+  return 0;
+}
@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NOB_IMPLEMENTATION
+#include "../nob.h"
+
+#include "engine.h"
+#include "solver.h"
+#include "dealdb.h"
+#include "platform.h"
+
+// Rates deals with the solver and appends them to a deal file:
+//
+//   ./build/classify <deal file> <variant> <draw count> <deals> [nodes per deal]
+//
+// Deal n is the shoe shuffled from seed n. Deals are solved a batch at a time on every core and
+// written in order once the batch is done, so the file always holds deals 0 to count-1 and running
+// the same command again picks up where an interrupted run stopped.
+
+#define CLASSIFY_BATCH 1024
+#define CLASSIFY_TABLE_BITS 20
+#define CLASSIFY_NODES 200000
+
+typedef struct {
+  DealInfo info;
+  CardId order[MAX_CARDS];
+} RatedDeal;
+
+typedef struct {
+  VariantKind variant;
+  size_t drawCount;
+  size_t maxNodes;
+  size_t first;
+  size_t count;
+  size_t next;  // next deal of the batch to take, shared by the workers
+  bool failed;  // a deal could not be dealt; the batch is not written
+  pthread_mutex_t mutex;
+  RatedDeal *deals;
+} Batch;
+
+typedef struct {
+  pthread_t thread;
+  Batch *batch;
+  Solver solver;
+  Solution solution;
+} Worker;
+
+// The number of positions the search had to look at is what a player feels most, so it sets the
+// tier; long lines and wide positions push a deal up.
+static DealTier RateSolution(const Solution *solution) {
+  if (solution->result == SOLVE_LOST) return DEAL_UNWINNABLE;
+  if (solution->result == SOLVE_UNKNOWN) return DEAL_UNRATED;
+  double effort = log2(1.0 + solution->nodes) + solution->count/100.0 + solution->branching/10.0;
+  if (effort < 9) return DEAL_EASY;
+  if (effort < 13) return DEAL_MEDIUM;
+  if (effort < 16) return DEAL_HARD;
+  return DEAL_EXPERT;
+}
+
+static bool RateDeal(Worker *worker, size_t index) {
+  Batch *batch = worker->batch;
+  RatedDeal *deal = &batch->deals[index];
+  uint64_t seed = batch->first + index;
+  size_t count = FillShoe(deal->order, variants[batch->variant].decks);
+  ShuffleCardIds(deal->order, count, &seed);
+  Board board;
+  if (!DealBoard(&board, batch->variant, deal->order, count, batch->drawCount)) return false;
+
+  SolveLimits limits = { .maxNodes = batch->maxNodes };
+  Solution *solution = &worker->solution;
+  Solve(&worker->solver, &board, limits, solution);
+  deal->info = (DealInfo) {
+    .nodes = solution->nodes,
+    .solutionLength = solution->result == SOLVE_WON ? solution->count : 0,
+    .branching = (uint16_t)(solution->branching*100),
+    .result = solution->result,
+    .tier = RateSolution(solution),
+  };
+  return true;
+}
+
+static void *ClassifyWorker(void *arg) {
+  Worker *worker = arg;
+  Batch *batch = worker->batch;
+  for (;;) {
+    pthread_mutex_lock(&batch->mutex);
+    size_t index = batch->next++;
+    bool failed = batch->failed;
+    pthread_mutex_unlock(&batch->mutex);
+    if (index >= batch->count || failed) break;
+    if (!RateDeal(worker, index)) {
+      pthread_mutex_lock(&batch->mutex);
+      batch->failed = true;
+      pthread_mutex_unlock(&batch->mutex);
+      break;
+    }
+  }
+  return NULL;
+}
+
+static const char *tierNames[DEAL_TIER_COUNT] = { "easy", "medium", "hard", "expert", "unrated", "unwinnable" };
+
+static void Usage(void) {
+  fprintf(stderr, "usage: classify <deal file> <variant> <draw count> <deals> [nodes per deal]\n");
+  for (size_t v = 0; v < VARIANT_COUNT; ++v) fprintf(stderr, "  variant %zu: %s\n", v, variants[v].name);
+}
+
+int main(int argc, char **argv) {
+  if (argc != 5 && argc != 6) {
+    Usage();
+    return 1;
+  }
+  const char *path = argv[1];
+  size_t variant = strtoull(argv[2], NULL, 10);
+  size_t drawCount = strtoull(argv[3], NULL, 10);
+  size_t total = strtoull(argv[4], NULL, 10);
+  size_t maxNodes = argc == 6 ? strtoull(argv[5], NULL, 10) : CLASSIFY_NODES;
+  if (variant >= VARIANT_COUNT) {
+    Usage();
+    return 1;
+  }
+  // Only variants drawing from a stock have a draw count; the rest deal as if it were 1.
+  if (variants[variant].stock != STOCK_DRAW) {
+    drawCount = 1;
+  } else if (drawCount != 1 && drawCount != 3) {
+    nob_log(NOB_ERROR, "%s draws 1 or 3 cards, not %zu", variants[variant].name, drawCount);
+    return 1;
+  }
+
+  DealWriter writer;
+  if (!OpenDealWriter(&writer, path, variant, drawCount)) return 1;
+  if (writer.count > 0) nob_log(NOB_INFO, "%s already holds %zu deals, going on from there", path, writer.count);
+
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t workerCount = cores > 0 ? cores : 1;
+  Worker *workers = calloc(workerCount, sizeof(*workers));
+  static Batch shared;
+  Batch *batch = &shared;
+  batch->deals = malloc(CLASSIFY_BATCH*sizeof(*batch->deals));
+  if (!workers || !batch->deals) {
+    nob_log(NOB_ERROR, "Could not allocate the batch");
+    return 1;
+  }
+  for (size_t w = 0; w < workerCount; ++w) {
+    workers[w].batch = batch;
+    if (!InitSolver(&workers[w].solver, CLASSIFY_TABLE_BITS)) return 1;
+  }
+  pthread_mutex_init(&batch->mutex, NULL);
+  batch->variant = variant;
+  batch->drawCount = writer.header.drawCount;
+  batch->maxNodes = maxNodes;
+
+  size_t tiers[DEAL_TIER_COUNT] = {0};
+  double start = NowSeconds();
+  size_t started = writer.count;
+  bool ok = true;
+  while (ok && writer.count < total) {
+    batch->first = writer.count;
+    batch->count = total - writer.count < CLASSIFY_BATCH ? total - writer.count : CLASSIFY_BATCH;
+    batch->next = 0;
+    for (size_t w = 0; w < workerCount; ++w) {
+      if (pthread_create(&workers[w].thread, NULL, ClassifyWorker, &workers[w]) != 0) {
+        nob_log(NOB_ERROR, "Could not start classify worker %zu", w);
+        return 1;
+      }
+    }
+    for (size_t w = 0; w < workerCount; ++w) pthread_join(workers[w].thread, NULL);
+    if (batch->failed) {
+      nob_log(NOB_ERROR, "Could not deal the batch starting at deal %zu", batch->first);
+      ok = false;
+      break;
+    }
+
+    for (size_t d = 0; d < batch->count && ok; ++d) {
+      ok = WriteDeal(&writer, &batch->deals[d].info, batch->deals[d].order);
+      tiers[batch->deals[d].info.tier]++;
+    }
+    double elapsed = NowSeconds() - start;
+    printf("%zu/%zu deals, %.1f deals/s:", writer.count, total, (writer.count - started)/elapsed);
+    for (size_t t = 0; t < DEAL_TIER_COUNT; ++t) printf(" %zu %s", tiers[t], tierNames[t]);
+    printf("\n");
+    fflush(stdout);
+  }
+
+  CloseDealWriter(&writer);
+  for (size_t w = 0; w < workerCount; ++w) FreeSolver(&workers[w].solver);
+  free(workers);
+  free(batch->deals);
+  pthread_mutex_destroy(&batch->mutex);
+  return ok ? 0 : 1;
+}
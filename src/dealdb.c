@@ -0,0 +1,132 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dealdb.h"
+#include "platform.h"
+#include "../nob.h"
+
+// Both are read straight out of the mapping, so their layout is the file format.
+_Static_assert(sizeof(DealFileHeader) == 32, "DealFileHeader has padding");
+_Static_assert(sizeof(DealInfo) == 16, "DealInfo has padding");
+
+static bool HeaderIsValid(const DealFileHeader *header) {
+  return memcmp(header->magic, DEAL_MAGIC, sizeof(header->magic)) == 0 && header->version == DEAL_VERSION &&
+    header->variant < VARIANT_COUNT && header->cardCount == (uint32_t)variants[header->variant].decks*CARDS_PER_DECK &&
+    header->recordSize == sizeof(DealInfo) + header->cardCount;
+}
+
+bool OpenDealDb(DealDb *db, const char *path) {
+  memset(db, 0, sizeof(*db));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    nob_log(NOB_ERROR, "Could not open deal file %s: %s", path, strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(DealFileHeader)) {
+    nob_log(NOB_ERROR, "Deal file %s is too short", path);
+    close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    nob_log(NOB_ERROR, "Could not map deal file %s: %s", path, strerror(errno));
+    return false;
+  }
+  db->data = data;
+  db->size = st.st_size;
+  db->header = data;
+  if (!HeaderIsValid(db->header)) {
+    nob_log(NOB_ERROR, "%s is not a deal file of this version", path);
+    CloseDealDb(db);
+    return false;
+  }
+  db->count = (db->size - sizeof(DealFileHeader))/db->header->recordSize;
+  return true;
+}
+
+void CloseDealDb(DealDb *db) {
+  if (db->data) munmap((void*)db->data, db->size);
+  memset(db, 0, sizeof(*db));
+}
+
+const DealInfo *DealAt(const DealDb *db, size_t number, const CardId **order) {
+  if (number >= db->count) return NULL;
+  const uint8_t *record = db->data + sizeof(DealFileHeader) + number*db->header->recordSize;
+  *order = record + sizeof(DealInfo);
+  return (const DealInfo*)record;
+}
+
+bool OpenDealWriter(DealWriter *writer, const char *path, VariantKind variant, size_t drawCount) {
+  memset(writer, 0, sizeof(*writer));
+  writer->fd = -1;
+  if (variant >= VARIANT_COUNT) {
+    nob_log(NOB_ERROR, "Invalid variant for OpenDealWriter: %d", variant);
+    return false;
+  }
+  DealFileHeader *header = &writer->header;
+  memcpy(header->magic, DEAL_MAGIC, sizeof(header->magic));
+  header->version = DEAL_VERSION;
+  header->variant = variant;
+  header->drawCount = variants[variant].stock == STOCK_DRAW ? drawCount : 1;
+  header->cardCount = variants[variant].decks*CARDS_PER_DECK;
+  header->recordSize = sizeof(DealInfo) + header->cardCount;
+
+  writer->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (writer->fd < 0) {
+    nob_log(NOB_ERROR, "Could not open deal file %s: %s", path, strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(writer->fd, &st) != 0) {
+    nob_log(NOB_ERROR, "Could not stat deal file %s: %s", path, strerror(errno));
+    CloseDealWriter(writer);
+    return false;
+  }
+  if (st.st_size == 0) {
+    if (!WriteAll(writer->fd, header, sizeof(*header))) {
+      nob_log(NOB_ERROR, "Could not write deal file %s: %s", path, strerror(errno));
+      CloseDealWriter(writer);
+      return false;
+    }
+    return true;
+  }
+
+  DealFileHeader existing;
+  bool same = (size_t)st.st_size >= sizeof(existing) && pread(writer->fd, &existing, sizeof(existing), 0) == sizeof(existing) &&
+    HeaderIsValid(&existing) && existing.variant == header->variant && existing.drawCount == header->drawCount;
+  if (!same) {
+    nob_log(NOB_ERROR, "%s already holds deals of another variant or draw count", path);
+    CloseDealWriter(writer);
+    return false;
+  }
+  writer->count = (st.st_size - sizeof(existing))/header->recordSize;
+  if (ftruncate(writer->fd, sizeof(existing) + writer->count*header->recordSize) != 0) {
+    nob_log(NOB_ERROR, "Could not trim deal file %s: %s", path, strerror(errno));
+    CloseDealWriter(writer);
+    return false;
+  }
+  return true;
+}
+
+bool WriteDeal(DealWriter *writer, const DealInfo *info, const CardId *order) {
+  uint8_t record[sizeof(DealInfo) + MAX_CARDS];
+  memcpy(record, info, sizeof(*info));
+  memcpy(record + sizeof(*info), order, writer->header.cardCount);
+  if (!WriteAll(writer->fd, record, writer->header.recordSize)) {
+    nob_log(NOB_ERROR, "Could not write deal %zu: %s", writer->count, strerror(errno));
+    return false;
+  }
+  writer->count++;
+  return true;
+}
+
+void CloseDealWriter(DealWriter *writer) {
+  if (writer->fd >= 0) close(writer->fd);
+  writer->fd = -1;
+}
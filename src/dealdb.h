@@ -0,0 +1,69 @@
+#ifndef DEALDB_H_
+#define DEALDB_H_
+
+#include "engine.h"
+
+// A deal file holds curated deals of one variant as fixed-size records: what is known about the
+// deal followed by its card order, ready for DealBoard. Readers map the file and index it by deal
+// number, so nothing is parsed or copied. Writers only ever append whole records, and the number
+// of deals is read off the file size, so an interrupted writer leaves a valid file behind.
+
+#define DEAL_MAGIC "CCDL"
+#define DEAL_VERSION 1
+
+typedef enum {
+  DEAL_EASY,
+  DEAL_MEDIUM,
+  DEAL_HARD,
+  DEAL_EXPERT,
+  // The solver ran out of budget before finding a win or proving there is none.
+  DEAL_UNRATED,
+  DEAL_UNWINNABLE,
+  DEAL_TIER_COUNT
+} DealTier;
+
+typedef struct {
+  char magic[4];
+  uint16_t version;
+  uint8_t variant;
+  uint8_t drawCount;
+  // Bytes per record: a DealInfo and the variant's cards.
+  uint32_t recordSize;
+  uint32_t cardCount;
+  uint8_t reserved[16];
+} DealFileHeader;
+
+typedef struct {
+  uint32_t nodes;           // positions the solver searched
+  uint16_t solutionLength;  // moves in the winning line, 0 when none was found
+  uint16_t branching;       // average number of legal moves, in hundredths
+  uint8_t result;           // SolveResult
+  uint8_t tier;             // DealTier
+  uint8_t reserved[6];
+} DealInfo;
+
+typedef struct {
+  const uint8_t *data;
+  size_t size;
+  const DealFileHeader *header;
+  size_t count;
+} DealDb;
+
+bool OpenDealDb(DealDb *db, const char *path);
+void CloseDealDb(DealDb *db);
+// NULL when `number` is past the end. `order` is pointed at the deal's cards inside the mapping.
+const DealInfo *DealAt(const DealDb *db, size_t number, const CardId **order);
+
+typedef struct {
+  int fd;
+  DealFileHeader header;
+  size_t count;
+} DealWriter;
+
+// Creates the file, or reopens it for more deals when it already holds deals of the same kind.
+// `writer->count` tells how many are there; a record cut short at the end is dropped.
+bool OpenDealWriter(DealWriter *writer, const char *path, VariantKind variant, size_t drawCount);
+bool WriteDeal(DealWriter *writer, const DealInfo *info, const CardId *order);
+void CloseDealWriter(DealWriter *writer);
+
+#endif // DEALDB_H_
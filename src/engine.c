@@ -0,0 +1,697 @@
+#include <string.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "engine.h"
+#include "../nob.h"
+
+const Variant variants[VARIANT_COUNT] = {
+  [VARIANT_KLONDIKE] = {
+    .name = "Klondike", .decks = 1, .suits = 4, .foundations = 4, .cells = 0, .tableau = 7,
+    .dealt = { 1, 2, 3, 4, 5, 6, 7 }, .faceUp = { 1, 1, 1, 1, 1, 1, 1 },
+    .build = BUILD_ALTERNATE, .group = BUILD_ALTERNATE, .supermove = false,
+    .empty = EMPTY_KING, .foundation = FOUND_BY_SUIT, .stock = STOCK_DRAW,
+  },
+  [VARIANT_FREECELL] = {
+    .name = "FreeCell", .decks = 1, .suits = 4, .foundations = 4, .cells = 4, .tableau = 8,
+    .dealt = { 7, 7, 7, 7, 6, 6, 6, 6 }, .faceUp = { 7, 7, 7, 7, 6, 6, 6, 6 },
+    .build = BUILD_ALTERNATE, .group = BUILD_ALTERNATE, .supermove = true,
+    .empty = EMPTY_ANY, .foundation = FOUND_BY_SUIT, .stock = STOCK_NONE,
+  },
+#define SPIDER(suitCount) { \
+    .name = "Spider (" #suitCount " suit)", .decks = 2, .suits = suitCount, .foundations = 8, .cells = 0, .tableau = 10, \
+    .dealt = { 6, 6, 6, 6, 5, 5, 5, 5, 5, 5 }, .faceUp = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 }, \
+    .build = BUILD_ANY_SUIT, .group = BUILD_SUIT, .supermove = false, \
+    .empty = EMPTY_ANY, .foundation = FOUND_RUN, .stock = STOCK_DEAL, \
+  }
+  [VARIANT_SPIDER1] = SPIDER(1),
+  [VARIANT_SPIDER2] = SPIDER(2),
+  [VARIANT_SPIDER4] = SPIDER(4),
+#undef SPIDER
+  [VARIANT_YUKON] = {
+    .name = "Yukon", .decks = 1, .suits = 4, .foundations = 4, .cells = 0, .tableau = 7,
+    .dealt = { 1, 6, 7, 8, 9, 10, 11 }, .faceUp = { 1, 5, 5, 5, 5, 5, 5 },
+    .build = BUILD_ALTERNATE, .group = BUILD_NONE, .supermove = false,
+    .empty = EMPTY_KING, .foundation = FOUND_BY_SUIT, .stock = STOCK_NONE,
+  },
+};
+
+static inline bool SameSuit(const Variant *variant, CardId a, CardId b) {
+  return VariantSuit(variant, CardIdSuit(a)) == VariantSuit(variant, CardIdSuit(b));
+}
+
+// True when `card` may lie directly on `onto` under `rule`.
+static inline bool Builds(const Variant *variant, BuildRule rule, CardId card, CardId onto) {
+  switch (rule) {
+    case BUILD_ALTERNATE: return CardIdValue(onto) == CardIdValue(card) + 1 && CardIdIsRed(onto) != CardIdIsRed(card);
+    case BUILD_SUIT:      return CardIdValue(onto) == CardIdValue(card) + 1 && SameSuit(variant, card, onto);
+    case BUILD_ANY_SUIT:  return CardIdValue(onto) == CardIdValue(card) + 1;
+    default:              return true;
+  }
+}
+
+// Only meaningful for FOUND_BY_SUIT, where foundation n holds suit n.
+static inline bool CanFound(const Board *board, CardId card) {
+  return FoundationHeight(board, CardIdSuit(card)) == (size_t)CardIdValue(card) - 1;
+}
+
+// Index of the deepest card that can be picked up together with everything on it.
+static inline size_t GroupStart(const Variant *variant, const Pile *pile) {
+  if (variant->group == BUILD_NONE) return pile->hidden;
+  size_t i = pile->count - 1;
+  while (i > pile->hidden && Builds(variant, variant->group, pile->cards[i], pile->cards[i-1])) i--;
+  return i;
+}
+
+static inline size_t FirstEmpty(const Board *board, size_t first, size_t count) {
+  for (size_t p = 0; p < count; ++p) {
+    if (board->piles[first + p].count == 0) return p;
+  }
+  return count;
+}
+
+static inline size_t CountEmpty(const Board *board, size_t first, size_t count) {
+  size_t empty = 0;
+  for (size_t p = 0; p < count; ++p) empty += board->piles[first + p].count == 0;
+  return empty;
+}
+
+// FreeCell moves a group through the free cells and empty files, so it can move (cells+1) cards
+// per empty file it can park a sub-group on, doubling each time.
+static inline size_t GroupLimit(const Variant *variant, size_t freeCells, size_t emptyFiles) {
+  return variant->supermove ? (freeCells + 1) << emptyFiles : PILE_CAPACITY;
+}
+
+static inline void SetLocation(Board *board, CardId id, size_t pile, size_t index) {
+  board->locations[id] = (CardLocation){ .pile = pile, .index = index };
+}
+
+_Static_assert(MAX_TABLEAU <= 16, "hiddenFiles has a bit per file");
+_Static_assert(MAX_FOUNDATIONS*4 <= 32, "foundationHeights has a nibble per foundation");
+
+// Keeps foundationHeights in step with `count` cards going onto (or, negative, off) `pile`.
+static inline void AddHeight(Board *board, size_t pile, int count) {
+  if (IsFoundation(pile)) board->foundationHeights += (uint32_t)count << 4*(pile - PILE_FOUNDATION);
+}
+
+// Cards from index `from` on have just come onto tableau `pile` as one group; they join the
+// group under them when their bottom card builds on its top.
+static inline void GrowGroup(Board *board, size_t pile, size_t from) {
+  const Pile *p = &board->piles[pile];
+  uint8_t *start = &board->groupStarts[pile - PILE_TABLEAU];
+  const Variant *variant = BoardVariant(board);
+  if (from == 0) *start = 0;
+  else if (!Builds(variant, variant->group, p->cards[from], p->cards[from-1])) *start = from;
+}
+
+// Cards have just left the top of tableau `pile`. The group under them only has to be found again
+// when the whole of the old one went.
+static inline void ShrinkGroup(Board *board, size_t pile) {
+  const Pile *p = &board->piles[pile];
+  uint8_t *start = &board->groupStarts[pile - PILE_TABLEAU];
+  if (p->count == 0) *start = 0;
+  else if (*start >= p->count) *start = GroupStart(BoardVariant(board), p);
+}
+
+static inline void PushMove(Move *moves, size_t *n, MoveKind kind, size_t from, size_t to, size_t count) {
+  moves[(*n)++] = (Move){ .kind = kind, .from = from, .to = to, .count = count };
+}
+
+bool DealBoard(Board *board, VariantKind kind, const CardId *order, size_t count, size_t drawCount) {
+  if (kind >= VARIANT_COUNT) {
+    nob_log(NOB_ERROR, "Invalid variant for DealBoard: %d", kind);
+    return false;
+  }
+  const Variant *variant = &variants[kind];
+  if (count != (size_t)variant->decks*CARDS_PER_DECK) {
+    nob_log(NOB_ERROR, "Invalid card count for DealBoard: %zu", count);
+    return false;
+  }
+  if (variant->stock == STOCK_DRAW && drawCount != 1 && drawCount != 3) {
+    nob_log(NOB_ERROR, "Invalid draw count for DealBoard: %zu", drawCount);
+    return false;
+  }
+  // Orders come from files too, so every id must be a card of the shoe and come up only once;
+  // anything else would index past the location table or leave it pointing at the wrong pile.
+  bool seen[CARD_ID_LIMIT] = {0};
+  for (size_t c = 0; c < count; ++c) {
+    CardId id = order[c];
+    if (id >= CARD_ID_LIMIT || CardIdDeck(id) >= variant->decks || CardIdValue(id) > VAL_KING || seen[id]) {
+      nob_log(NOB_ERROR, "Invalid card order for DealBoard: card %d at %zu", id, c);
+      return false;
+    }
+    seen[id] = true;
+  }
+  memset(board, 0, sizeof(*board));
+  board->variant = kind;
+  board->drawCount = variant->stock == STOCK_DRAW ? drawCount : 1;
+  size_t next = 0;
+  for (size_t t = 0; t < variant->tableau; ++t) {
+    Pile *pile = &board->piles[PILE_TABLEAU + t];
+    memcpy(pile->cards, &order[next], variant->dealt[t]);
+    pile->count = variant->dealt[t];
+    pile->hidden = variant->dealt[t] - variant->faceUp[t];
+    if (pile->hidden > 0) board->hiddenFiles |= 1u << t;
+    board->groupStarts[t] = GroupStart(variant, pile);
+    for (size_t c = 0; c < pile->count; ++c) SetLocation(board, pile->cards[c], PILE_TABLEAU + t, c);
+    next += variant->dealt[t];
+  }
+  board->talon.count = count - next;
+  memcpy(board->talon.cards, &order[next], board->talon.count);
+  for (size_t c = 0; c < board->talon.count; ++c) SetLocation(board, board->talon.cards[c], PILE_STOCK, c);
+  return true;
+}
+
+PileView ViewPile(const Board *board, size_t pile) {
+  const Talon *talon = &board->talon;
+  if (pile == PILE_STOCK) return (PileView){ &talon->cards[talon->stockStart], StockCount(board), StockCount(board) };
+  if (pile == PILE_WASTE) return (PileView){ talon->cards, talon->wasteCount, 0 };
+  const Pile *p = &board->piles[pile];
+  return (PileView){ p->cards, p->count, p->hidden };
+}
+
+// Cards are matched against file tops by a key holding everything the build rule looks at, so
+// the set of files taking a card is a single lookup: value and color, value and suit, or value.
+#define MAX_BUILD_KEYS (VAL_COUNT*SUIT_COUNT)
+
+static inline size_t BuildKeyCount(const Variant *variant) {
+  switch (variant->build) {
+    case BUILD_ALTERNATE: return VAL_COUNT*2;
+    case BUILD_SUIT:      return VAL_COUNT*SUIT_COUNT;
+    default:              return VAL_COUNT;
+  }
+}
+
+static inline size_t BuildKey(const Variant *variant, int value, CardId card) {
+  switch (variant->build) {
+    case BUILD_ALTERNATE: return value*2 + CardIdIsRed(card);
+    case BUILD_SUIT:      return value*SUIT_COUNT + VariantSuit(variant, CardIdSuit(card));
+    default:              return value;
+  }
+}
+
+// Key of the cards that go onto `top`.
+static inline size_t AcceptedKey(const Variant *variant, CardId top) {
+  int value = CardIdValue(top) - 1;
+  if (variant->build == BUILD_ALTERNATE) return value*2 + !CardIdIsRed(top);
+  return BuildKey(variant, value, top);
+}
+
+CardLocation LocateCard(const Board *board, CardId id) {
+  CardLocation where = board->locations[id];
+  if (where.pile != PILE_STOCK) return where;
+  if (where.index < board->talon.wasteCount) return (CardLocation){ .pile = PILE_WASTE, .index = where.index };
+  return (CardLocation){ .pile = PILE_STOCK, .index = where.index - board->talon.stockStart };
+}
+
+size_t MovableFrom(const Board *board, size_t pile) {
+  PileView view = ViewPile(board, pile);
+  if (view.count == 0 || pile == PILE_STOCK) return view.count;
+  if (IsTableau(pile)) return GroupStart(BoardVariant(board), &board->piles[pile]);
+  if (IsFoundation(pile) && BoardVariant(board)->foundation != FOUND_BY_SUIT) return view.count;
+  return view.count - 1;
+}
+
+// Moves of the single card on top of `from`: to its foundation, onto a file or to the first empty
+// file. Used for the free cells, the waste and (back to the tableau only) the foundations.
+static inline __attribute__((always_inline)) void PushCardMoves(const Board *board, const Variant *variant, size_t from, const uint16_t *acceptors,
+                          size_t firstEmpty, Move *moves, size_t *n) {
+  PileView src = ViewPile(board, from);
+  if (src.count == 0) return;
+  CardId card = src.cards[src.count-1];
+  if (!IsFoundation(from) && variant->foundation == FOUND_BY_SUIT && CanFound(board, card))
+    PushMove(moves, n, MOVE_TRANSFER, from, PILE_FOUNDATION + CardIdSuit(card), 1);
+  uint32_t targets = acceptors[BuildKey(variant, CardIdValue(card), card)];
+  while (targets) {
+    size_t d = __builtin_ctz(targets);
+    targets &= targets - 1;
+    PushMove(moves, n, MOVE_TRANSFER, from, PILE_TABLEAU + d, 1);
+  }
+  if (firstEmpty < variant->tableau && (variant->empty == EMPTY_ANY || CardIdValue(card) == VAL_KING))
+    PushMove(moves, n, MOVE_TRANSFER, from, PILE_TABLEAU + firstEmpty, 1);
+}
+
+// Moves of the cards from index `i` of tableau file `s` up: onto each file that takes card i and to
+// the first empty file.
+static inline __attribute__((always_inline)) void PushGroupMoves(const Variant *variant, const Pile *pile, size_t s, size_t i,
+                          const uint16_t *acceptors, size_t firstEmpty, size_t emptyLimit, Move *moves, size_t *n) {
+  CardId card = pile->cards[i];
+  size_t count = pile->count - i;
+  uint32_t targets = acceptors[BuildKey(variant, CardIdValue(card), card)] & ~(1u << s);
+  while (targets) {
+    size_t d = __builtin_ctz(targets);
+    targets &= targets - 1;
+    PushMove(moves, n, MOVE_TRANSFER, PILE_TABLEAU + s, PILE_TABLEAU + d, count);
+  }
+  if (firstEmpty < variant->tableau && i > 0 && count <= emptyLimit &&
+      (variant->empty == EMPTY_ANY || CardIdValue(card) == VAL_KING))
+    PushMove(moves, n, MOVE_TRANSFER, PILE_TABLEAU + s, PILE_TABLEAU + firstEmpty, count);
+}
+
+// The generator is written once against the rules and instantiated per variant below. Each copy
+// is inlined with its variant known at compile time, so the rule switches fold away and the inner
+// loops only look at cards.
+static inline __attribute__((always_inline)) size_t GenerateMovesWith(const Board *board, Move *moves, const Variant *variant) {
+  size_t n = 0;
+
+  // acceptors[key] is the set of files whose top takes the cards with that key. Only the keys the
+  // build rule can produce are cleared.
+  uint16_t acceptors[MAX_BUILD_KEYS];
+  memset(acceptors, 0, BuildKeyCount(variant)*sizeof(*acceptors));
+  // Bit v is set when some file top takes cards of value v.
+  uint32_t wanted = 0;
+  size_t firstEmpty = variant->tableau;
+  size_t emptyFiles = 0;
+  size_t firstFoundation = variant->foundation == FOUND_RUN ? FirstEmpty(board, PILE_FOUNDATION, variant->foundations) : 0;
+  for (size_t t = 0; t < variant->tableau; ++t) {
+    const Pile *pile = &board->piles[PILE_TABLEAU + t];
+    if (pile->count == 0) {
+      if (firstEmpty == variant->tableau) firstEmpty = t;
+      emptyFiles++;
+      continue;
+    }
+    CardId top = pile->cards[pile->count-1];
+    acceptors[AcceptedKey(variant, top)] |= 1u << t;
+    wanted |= 1u << (CardIdValue(top) - 1);
+    if (variant->foundation == FOUND_BY_SUIT) {
+      if (CanFound(board, top)) PushMove(moves, &n, MOVE_TRANSFER, PILE_TABLEAU + t, PILE_FOUNDATION + CardIdSuit(top), 1);
+    } else if (CardIdValue(top) == VAL_ACE && pile->count - board->groupStarts[t] >= VAL_KING && firstFoundation < variant->foundations) {
+      PushMove(moves, &n, MOVE_TRANSFER, PILE_TABLEAU + t, PILE_FOUNDATION + firstFoundation, VAL_KING);
+    }
+  }
+
+  size_t firstCell = FirstEmpty(board, PILE_CELL, variant->cells);
+  size_t freeCells = CountEmpty(board, PILE_CELL, variant->cells);
+  size_t limit = GroupLimit(variant, freeCells, emptyFiles);
+  size_t emptyLimit = emptyFiles > 0 ? GroupLimit(variant, freeCells, emptyFiles - 1) : 0;
+
+  // Tableau to tableau: every group a file can give up, onto each file that takes its bottom card.
+  // With a group rule the cards of a run go up one value each, so instead of walking the run only
+  // the cards whose value a file top or an empty file takes are looked at, deepest first.
+  if (firstEmpty < variant->tableau && emptyLimit > 0) wanted |= variant->empty == EMPTY_ANY ? ~0u : 1u << VAL_KING;
+  for (size_t s = 0; s < variant->tableau; ++s) {
+    const Pile *pile = &board->piles[PILE_TABLEAU + s];
+    if (pile->count == 0) continue;
+    size_t lowest = board->groupStarts[s];
+    if (pile->count - lowest > limit) lowest = pile->count - limit;
+    if (variant->group == BUILD_NONE) {
+      for (size_t i = lowest; i < pile->count; ++i) {
+        PushGroupMoves(variant, pile, s, i, acceptors, firstEmpty, emptyLimit, moves, &n);
+      }
+    } else {
+      // Bit k is the card k below the top, whose value is the top's plus k.
+      uint32_t values = wanted >> CardIdValue(pile->cards[pile->count-1]) & ((1u << (pile->count - lowest)) - 1);
+      while (values) {
+        size_t k = 31 - __builtin_clz(values);
+        values &= ~(1u << k);
+        PushGroupMoves(variant, pile, s, pile->count - 1 - k, acceptors, firstEmpty, emptyLimit, moves, &n);
+      }
+    }
+    if (firstCell < variant->cells) PushMove(moves, &n, MOVE_TRANSFER, PILE_TABLEAU + s, PILE_CELL + firstCell, 1);
+  }
+
+  for (size_t c = 0; c < variant->cells; ++c) {
+    PushCardMoves(board, variant, PILE_CELL + c, acceptors, firstEmpty, moves, &n);
+  }
+  if (variant->stock == STOCK_DRAW) PushCardMoves(board, variant, PILE_WASTE, acceptors, firstEmpty, moves, &n);
+  if (variant->foundation == FOUND_BY_SUIT) {
+    for (size_t f = 0; f < variant->foundations; ++f) {
+      PushCardMoves(board, variant, PILE_FOUNDATION + f, acceptors, firstEmpty, moves, &n);
+    }
+  }
+
+  size_t stock = StockCount(board);
+  if (variant->stock == STOCK_DRAW) {
+    if (stock > 0) PushMove(moves, &n, MOVE_DRAW, PILE_STOCK, PILE_WASTE, stock < board->drawCount ? stock : board->drawCount);
+    else if (WasteCount(board) > 0) PushMove(moves, &n, MOVE_RECYCLE, PILE_WASTE, PILE_STOCK, WasteCount(board));
+  } else if (variant->stock == STOCK_DEAL && stock > 0 && emptyFiles == 0) {
+    PushMove(moves, &n, MOVE_DEAL, PILE_STOCK, PILE_TABLEAU, variant->tableau);
+  }
+
+  return n;
+}
+
+#define SPECIALIZE(name, kind) \
+  static size_t name(const Board *board, Move *moves) { return GenerateMovesWith(board, moves, &variants[kind]); }
+SPECIALIZE(GenerateKlondike, VARIANT_KLONDIKE)
+SPECIALIZE(GenerateFreeCell, VARIANT_FREECELL)
+SPECIALIZE(GenerateSpider1, VARIANT_SPIDER1)
+SPECIALIZE(GenerateSpider2, VARIANT_SPIDER2)
+SPECIALIZE(GenerateSpider4, VARIANT_SPIDER4)
+SPECIALIZE(GenerateYukon, VARIANT_YUKON)
+#undef SPECIALIZE
+
+static size_t (*const generators[VARIANT_COUNT])(const Board *board, Move *moves) = {
+  [VARIANT_KLONDIKE] = GenerateKlondike,
+  [VARIANT_FREECELL] = GenerateFreeCell,
+  [VARIANT_SPIDER1] = GenerateSpider1,
+  [VARIANT_SPIDER2] = GenerateSpider2,
+  [VARIANT_SPIDER4] = GenerateSpider4,
+  [VARIANT_YUKON] = GenerateYukon,
+};
+
+size_t GenerateMoves(const Board *board, Move *moves) {
+  return generators[board->variant](board, moves);
+}
+
+size_t GenerateMovesGeneric(const Board *board, Move *moves) {
+  return GenerateMovesWith(board, moves, BoardVariant(board));
+}
+
+void GatherTopKeys(const Board *boards, size_t count, uint8_t *keys) {
+  _Static_assert(MAX_TABLEAU <= TOP_KEY_STRIDE, "A board's tops must fit one stride");
+  memset(keys, TOP_KEY_NONE, count*TOP_KEY_STRIDE);
+  if (count == 0) return;
+  const Variant *variant = BoardVariant(&boards[0]);
+  for (size_t b = 0; b < count; ++b) {
+    for (size_t t = 0; t < variant->tableau; ++t) {
+      const Pile *pile = &boards[b].piles[PILE_TABLEAU + t];
+      if (pile->count > pile->hidden) keys[b*TOP_KEY_STRIDE + t] = AcceptedKey(variant, pile->cards[pile->count-1]);
+    }
+  }
+}
+
+uint8_t CardBuildKey(const Board *board, CardId card) {
+  return BuildKey(BoardVariant(board), CardIdValue(card), card);
+}
+
+void MatchTopKeysScalar(const uint8_t *keys, size_t count, uint8_t key, uint16_t *masks) {
+  for (size_t b = 0; b < count; ++b) {
+    uint16_t mask = 0;
+    for (size_t t = 0; t < TOP_KEY_STRIDE; ++t) {
+      if (keys[b*TOP_KEY_STRIDE + t] == key) mask |= 1u << t;
+    }
+    masks[b] = mask;
+  }
+}
+
+#if defined(__x86_64__)
+// SSE2 is part of x86-64, so this one needs no check.
+static void MatchTopKeysSse2(const uint8_t *keys, size_t count, uint8_t key, uint16_t *masks) {
+  __m128i want = _mm_set1_epi8((char)key);
+  for (size_t b = 0; b < count; ++b) {
+    __m128i tops = _mm_loadu_si128((const __m128i*)&keys[b*TOP_KEY_STRIDE]);
+    masks[b] = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(tops, want));
+  }
+}
+
+// Two boards per compare. Built for AVX2 on its own so the rest of the engine runs anywhere.
+__attribute__((target("avx2")))
+static void MatchTopKeysAvx2(const uint8_t *keys, size_t count, uint8_t key, uint16_t *masks) {
+  __m256i want = _mm256_set1_epi8((char)key);
+  size_t b = 0;
+  for (; b + 2 <= count; b += 2) {
+    __m256i tops = _mm256_loadu_si256((const __m256i*)&keys[b*TOP_KEY_STRIDE]);
+    uint32_t bits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(tops, want));
+    masks[b] = (uint16_t)bits;
+    masks[b+1] = (uint16_t)(bits >> 16);
+  }
+  MatchTopKeysSse2(&keys[b*TOP_KEY_STRIDE], count - b, key, &masks[b]);
+}
+
+void MatchTopKeys(const uint8_t *keys, size_t count, uint8_t key, uint16_t *masks) {
+  if (__builtin_cpu_supports("avx2")) MatchTopKeysAvx2(keys, count, key, masks);
+  else MatchTopKeysSse2(keys, count, key, masks);
+}
+
+const char *MatchTopKeysPath(void) {
+  return __builtin_cpu_supports("avx2") ? "avx2" : "sse2";
+}
+#else
+void MatchTopKeys(const uint8_t *keys, size_t count, uint8_t key, uint16_t *masks) {
+  MatchTopKeysScalar(keys, count, key, masks);
+}
+
+const char *MatchTopKeysPath(void) {
+  return "scalar";
+}
+#endif
+
+// Whether `pile` is one the variant plays with. The waste only ever counts as a source.
+static inline bool InVariant(const Variant *variant, size_t pile) {
+  if (IsFoundation(pile)) return pile - PILE_FOUNDATION < variant->foundations;
+  if (IsCell(pile)) return pile - PILE_CELL < variant->cells;
+  if (IsTableau(pile)) return pile - PILE_TABLEAU < variant->tableau;
+  return pile == PILE_WASTE && variant->stock == STOCK_DRAW;
+}
+
+bool IsMoveLegal(const Board *board, Move move) {
+  const Variant *variant = BoardVariant(board);
+  switch (move.kind) {
+    case MOVE_DRAW:    return variant->stock == STOCK_DRAW && StockCount(board) > 0;
+    case MOVE_RECYCLE: return variant->stock == STOCK_DRAW && StockCount(board) == 0 && WasteCount(board) > 0;
+    case MOVE_DEAL:    return variant->stock == STOCK_DEAL && StockCount(board) > 0 && CountEmpty(board, PILE_TABLEAU, variant->tableau) == 0;
+    case MOVE_TRANSFER: break;
+    default: return false;
+  }
+
+  if (move.from == move.to || move.to == PILE_WASTE) return false;
+  if (!InVariant(variant, move.from) || !InVariant(variant, move.to)) return false;
+  PileView src = ViewPile(board, move.from);
+  const Pile *dst = &board->piles[move.to];
+  if (move.count == 0 || move.count > src.count - src.hidden) return false;
+  if (!IsTableau(move.from)) {
+    if (move.count != 1) return false;
+    if (IsFoundation(move.from) && (variant->foundation != FOUND_BY_SUIT || !IsTableau(move.to))) return false;
+    if (IsCell(move.from) && IsCell(move.to)) return false;
+  }
+
+  size_t first = src.count - move.count;
+  for (size_t c = first + 1; c < src.count; ++c) {
+    if (!Builds(variant, variant->group, src.cards[c], src.cards[c-1])) return false;
+  }
+
+  CardId card = src.cards[first];
+  if (IsFoundation(move.to)) {
+    if (variant->foundation == FOUND_RUN)
+      return IsTableau(move.from) && move.count == VAL_KING && dst->count == 0 && CardIdValue(card) == VAL_KING;
+    return move.count == 1 && CardIdSuit(card) == (Suit)(move.to - PILE_FOUNDATION) && CanFound(board, card);
+  }
+  if (IsCell(move.to)) return move.count == 1 && dst->count == 0;
+
+  size_t emptyFiles = CountEmpty(board, PILE_TABLEAU, variant->tableau) - (dst->count == 0);
+  if (move.count > GroupLimit(variant, CountEmpty(board, PILE_CELL, variant->cells), emptyFiles)) return false;
+  if (dst->count == 0) return variant->empty == EMPTY_ANY || CardIdValue(card) == VAL_KING;
+  return Builds(variant, variant->build, card, dst->cards[dst->count-1]);
+}
+
+void ApplyMove(Board *board, Move move) {
+  Talon *talon = &board->talon;
+  switch (move.kind) {
+    case MOVE_DRAW: {
+      size_t n = StockCount(board) < board->drawCount ? StockCount(board) : board->drawCount;
+      if (talon->wasteCount != talon->stockStart) {
+        memmove(&talon->cards[talon->wasteCount], &talon->cards[talon->stockStart], n);
+        for (size_t c = talon->wasteCount; c < talon->wasteCount + n; ++c) SetLocation(board, talon->cards[c], PILE_STOCK, c);
+      }
+      talon->wasteCount += n;
+      talon->stockStart += n;
+    } break;
+    case MOVE_RECYCLE:
+      talon->count = talon->wasteCount;
+      talon->stockStart = 0;
+      talon->wasteCount = 0;
+      break;
+    case MOVE_DEAL: {
+      const Variant *variant = BoardVariant(board);
+      for (size_t t = 0; t < variant->tableau && talon->stockStart < talon->count; ++t) {
+        Pile *pile = &board->piles[PILE_TABLEAU + t];
+        SetLocation(board, talon->cards[talon->stockStart], PILE_TABLEAU + t, pile->count);
+        pile->cards[pile->count++] = talon->cards[talon->stockStart++];
+        GrowGroup(board, PILE_TABLEAU + t, pile->count - 1);
+      }
+    } break;
+    case MOVE_TRANSFER: {
+      Pile *dst = &board->piles[move.to];
+      if (move.from == PILE_WASTE) {
+        SetLocation(board, talon->cards[talon->wasteCount-1], move.to, dst->count);
+        dst->cards[dst->count++] = talon->cards[--talon->wasteCount];
+        AddHeight(board, move.to, 1);
+        if (IsTableau(move.to)) GrowGroup(board, move.to, dst->count - 1);
+        break;
+      }
+      Pile *src = &board->piles[move.from];
+      memcpy(&dst->cards[dst->count], &src->cards[src->count - move.count], move.count);
+      for (size_t c = dst->count; c < dst->count + move.count; ++c) SetLocation(board, dst->cards[c], move.to, c);
+      dst->count += move.count;
+      src->count -= move.count;
+      AddHeight(board, move.to, move.count);
+      AddHeight(board, move.from, -(int)move.count);
+      if (src->count > 0 && src->count == src->hidden) {
+        src->hidden--;
+        if (src->hidden == 0) board->hiddenFiles &= ~(1u << (move.from - PILE_TABLEAU));
+      }
+      if (IsTableau(move.to)) GrowGroup(board, move.to, dst->count - move.count);
+      if (IsTableau(move.from)) ShrinkGroup(board, move.from);
+    } break;
+    default:
+      break;
+  }
+}
+
+// Thirteen in every nibble: each foundation the variant uses holds a full suit.
+#define FULL_HEIGHTS 0xDDDDDDDDu
+
+bool IsBoardWon(const Board *board) {
+  return board->foundationHeights == FULL_HEIGHTS >> 4*(MAX_FOUNDATIONS - BoardVariant(board)->foundations);
+}
+
+bool BoardsEqual(const Board *a, const Board *b) {
+  if (a->variant != b->variant || a->drawCount != b->drawCount) return false;
+  if (WasteCount(a) != WasteCount(b) || StockCount(a) != StockCount(b)) return false;
+  if (memcmp(a->talon.cards, b->talon.cards, WasteCount(a)) != 0) return false;
+  if (memcmp(&a->talon.cards[a->talon.stockStart], &b->talon.cards[b->talon.stockStart], StockCount(a)) != 0) return false;
+  for (size_t p = 0; p < PILE_COUNT; ++p) {
+    const Pile *pa = &a->piles[p];
+    const Pile *pb = &b->piles[p];
+    if (pa->count != pb->count || pa->hidden != pb->hidden) return false;
+    if (memcmp(pa->cards, pb->cards, pa->count) != 0) return false;
+  }
+  return true;
+}
+
+uint64_t HashBoard(const Board *board) {
+  uint64_t h = 0xCBF29CE484222325ull;
+  h = (h ^ board->variant) * 0x100000001B3ull;
+  h = (h ^ board->drawCount) * 0x100000001B3ull;
+  for (size_t p = PILE_STOCK; p <= PILE_WASTE; ++p) {
+    PileView view = ViewPile(board, p);
+    h = (h ^ view.count) * 0x100000001B3ull;
+    for (size_t c = 0; c < view.count; ++c) h = (h ^ view.cards[c]) * 0x100000001B3ull;
+  }
+  for (size_t p = 0; p < PILE_COUNT; ++p) {
+    const Pile *pile = &board->piles[p];
+    h = (h ^ pile->count) * 0x100000001B3ull;
+    h = (h ^ pile->hidden) * 0x100000001B3ull;
+    for (size_t c = 0; c < pile->count; ++c) h = (h ^ pile->cards[c]) * 0x100000001B3ull;
+  }
+  return h;
+}
+
+bool CanAutoComplete(const Board *board) {
+  const Variant *variant = BoardVariant(board);
+  if (variant->foundation != FOUND_BY_SUIT || HasHiddenCards(board)) return false;
+  for (size_t t = 0; t < variant->tableau; ++t) {
+    const Pile *pile = &board->piles[PILE_TABLEAU + t];
+    for (size_t c = 1; c < pile->count; ++c) {
+      if (CardIdValue(pile->cards[c]) > CardIdValue(pile->cards[c-1])) return false;
+    }
+  }
+  // Drawing three, some waste cards may never come up on top, so the talon has to be played out.
+  if (board->drawCount > 1 && StockCount(board) + WasteCount(board) > 0) return false;
+  return !IsBoardWon(board);
+}
+
+// Sets `move` to take the top card of `from` to its foundation, if it can go there.
+static bool FoundationMove(const Board *board, size_t from, Move *move) {
+  PileView src = ViewPile(board, from);
+  if (src.count == 0 || !CanFound(board, src.cards[src.count-1])) return false;
+  *move = (Move){ .kind = MOVE_TRANSFER, .from = from, .to = PILE_FOUNDATION + CardIdSuit(src.cards[src.count-1]), .count = 1 };
+  return true;
+}
+
+size_t AutoComplete(Board *board, Move *moves) {
+  const Variant *variant = BoardVariant(board);
+  size_t n = 0;
+  // Draws and recycles since the last card went up; more than a full pass means nothing is playable.
+  size_t idle = 0;
+  while (!IsBoardWon(board)) {
+    size_t stock = StockCount(board);
+    size_t waste = WasteCount(board);
+    Move move = { .kind = MOVE_KIND_COUNT };
+    bool found = variant->stock == STOCK_DRAW && FoundationMove(board, PILE_WASTE, &move);
+    for (size_t c = 0; c < variant->cells && !found; ++c) found = FoundationMove(board, PILE_CELL + c, &move);
+    for (size_t t = 0; t < variant->tableau && !found; ++t) found = FoundationMove(board, PILE_TABLEAU + t, &move);
+    if (found) {
+      idle = 0;
+    } else {
+      if (idle++ > stock + waste + 1) break;
+      if (stock > 0) move = (Move){ .kind = MOVE_DRAW, .from = PILE_STOCK, .to = PILE_WASTE, .count = stock < board->drawCount ? stock : board->drawCount };
+      else if (waste > 0) move = (Move){ .kind = MOVE_RECYCLE, .from = PILE_WASTE, .to = PILE_STOCK, .count = waste };
+      else break;
+    }
+    ApplyMove(board, move);
+    moves[n++] = move;
+  }
+  return n;
+}
+
+bool FindCompletedRun(const Board *board, Move *move) {
+  const Variant *variant = BoardVariant(board);
+  if (variant->foundation != FOUND_RUN) return false;
+  size_t to = FirstEmpty(board, PILE_FOUNDATION, variant->foundations);
+  if (to == variant->foundations) return false;
+  for (size_t t = 0; t < variant->tableau; ++t) {
+    const Pile *pile = &board->piles[PILE_TABLEAU + t];
+    if (pile->count < VAL_KING || CardIdValue(pile->cards[pile->count-1]) != VAL_ACE) continue;
+    if (pile->count - board->groupStarts[t] < VAL_KING) continue;
+    *move = (Move){ .kind = MOVE_TRANSFER, .from = PILE_TABLEAU + t, .to = PILE_FOUNDATION + to, .count = VAL_KING };
+    return true;
+  }
+  return false;
+}
+
+size_t FillShoe(CardId *ids, size_t decks) {
+  size_t n = 0;
+  for (size_t d = 0; d < decks; ++d) {
+    for (int s = SUIT_CLUBS; s < SUIT_COUNT; ++s) {
+      for (int v = VAL_ACE; v < VAL_COUNT; ++v) ids[n++] = CardIdInDeck(CardIdMake(s, v), d);
+    }
+  }
+  return n;
+}
+
+uint64_t NextRandom(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+void ShuffleCardIds(CardId *ids, size_t count, uint64_t *state) {
+  for (size_t i = count; i > 1; --i) {
+    size_t j = NextRandom(state) % i;
+    CardId tmp = ids[i-1];
+    ids[i-1] = ids[j];
+    ids[j] = tmp;
+  }
+}
+
+bool DealSeed(Board *board, VariantKind variant, uint64_t seed, size_t drawCount) {
+  if (variant >= VARIANT_COUNT) {
+    nob_log(NOB_ERROR, "Invalid variant for DealSeed: %d", variant);
+    return false;
+  }
+  CardId order[MAX_CARDS];
+  size_t count = FillShoe(order, variants[variant].decks);
+  ShuffleCardIds(order, count, &seed);
+  return DealBoard(board, variant, order, count, drawCount);
+}
+
+void ShuffleHiddenCards(Board *board, uint64_t *state) {
+  CardId ids[MAX_CARDS];
+  size_t n = 0;
+  for (size_t t = 0; t < MAX_TABLEAU; ++t) {
+    Pile *pile = &board->piles[PILE_TABLEAU + t];
+    memcpy(&ids[n], pile->cards, pile->hidden);
+    n += pile->hidden;
+  }
+  Talon *talon = &board->talon;
+  memcpy(&ids[n], &talon->cards[talon->stockStart], StockCount(board));
+  n += StockCount(board);
+  ShuffleCardIds(ids, n, state);
+
+  n = 0;
+  for (size_t t = 0; t < MAX_TABLEAU; ++t) {
+    Pile *pile = &board->piles[PILE_TABLEAU + t];
+    for (size_t c = 0; c < pile->hidden; ++c) {
+      pile->cards[c] = ids[n++];
+      SetLocation(board, pile->cards[c], PILE_TABLEAU + t, c);
+    }
+  }
+  for (size_t c = talon->stockStart; c < talon->count; ++c) {
+    talon->cards[c] = ids[n++];
+    SetLocation(board, talon->cards[c], PILE_STOCK, c);
+  }
+}
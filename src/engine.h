@@ -0,0 +1,305 @@
+#ifndef ENGINE_H_
+#define ENGINE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The engine is the headless part of the game: a packed board, the rules of every variant and a
+// move generator. It knows nothing about raylib so solvers and tools can link it on its own.
+
+typedef enum {
+  SUIT_CLUBS,
+  SUIT_DIAMONDS,
+  SUIT_HEARTS,
+  SUIT_SPADES,
+  SUIT_COUNT
+} Suit;
+
+typedef enum {
+  VAL_ACE = 1,
+  VAL_TWO,
+  VAL_THREE,
+  VAL_FOUR,
+  VAL_FIVE,
+  VAL_SIX,
+  VAL_SEVEN,
+  VAL_EIGHT,
+  VAL_NINE,
+  VAL_TEN,
+  VAL_JACK,
+  VAL_QUEEN,
+  VAL_KING,
+  VAL_COUNT
+} Value;
+
+// A card is identified by a single byte: deck << 6 | (value-1) << 2 | suit. Everything the rules
+// look at decodes with a shift or a mask, and the deck bits keep the copies in a multi-deck shoe
+// apart, so every card of a game has an id of its own.
+typedef uint8_t CardId;
+
+#define CARDS_PER_DECK 52
+#define CARD_NONE 0xFF
+// The most decks any variant plays with. Two decks are the largest shoe, so a pile never holds
+// more than that.
+#define MAX_DECKS 2
+#define MAX_CARDS (MAX_DECKS*CARDS_PER_DECK)
+// Every id in a shoe is below this, so tables indexed by card id need this many entries.
+#define CARD_ID_LIMIT (MAX_DECKS << 6)
+
+static inline CardId CardIdMake(Suit suit, Value value) { return (CardId)((value-1) << 2 | suit); }
+static inline CardId CardIdInDeck(CardId id, size_t deck) { return (CardId)(deck << 6 | (id & 63)); }
+static inline size_t CardIdDeck(CardId id) { return id >> 6; }
+static inline Suit CardIdSuit(CardId id) { return (Suit)(id & 3); }
+static inline Value CardIdValue(CardId id) { return (Value)(((id >> 2) & 15) + 1); }
+// Diamonds and hearts are the two middle suits.
+static inline bool CardIdIsRed(CardId id) { return ((id ^ (id >> 1)) & 1) != 0; }
+
+// Writes the ids of `decks` full decks, deck by deck, and returns how many there are.
+size_t FillShoe(CardId *ids, size_t decks);
+
+// The most any variant uses besides the decks.
+#define MAX_FOUNDATIONS 8
+#define MAX_CELLS 4
+#define MAX_TABLEAU 10
+#define PILE_CAPACITY MAX_CARDS
+// Klondike leaves 24 cards in the stock, Spider 50.
+#define TALON_CAPACITY 50
+
+// Piles are addressed by a single index with the same layout in every variant; a variant uses
+// the first few piles of each kind and leaves the rest empty. The stock and the waste are
+// addressed past the end of Board.piles because they live in the talon.
+typedef enum {
+  PILE_FOUNDATION,
+  PILE_CELL = PILE_FOUNDATION + MAX_FOUNDATIONS,
+  PILE_TABLEAU = PILE_CELL + MAX_CELLS,
+  PILE_COUNT = PILE_TABLEAU + MAX_TABLEAU,
+  PILE_STOCK = PILE_COUNT,
+  PILE_WASTE,
+} PileIndex;
+
+typedef enum {
+  VARIANT_KLONDIKE,
+  VARIANT_FREECELL,
+  VARIANT_SPIDER1,
+  VARIANT_SPIDER2,
+  VARIANT_SPIDER4,
+  VARIANT_YUKON,
+  VARIANT_COUNT
+} VariantKind;
+
+// How one card goes onto another: BUILD_NONE accepts anything, which is how Yukon picks up any
+// face-up card together with whatever lies on it.
+typedef enum {
+  BUILD_ALTERNATE,
+  BUILD_SUIT,
+  BUILD_ANY_SUIT,
+  BUILD_NONE,
+} BuildRule;
+
+typedef enum {
+  EMPTY_KING,
+  EMPTY_ANY,
+} EmptyRule;
+
+// FOUND_BY_SUIT builds foundation n up from the ace in suit n; FOUND_RUN takes a finished king to
+// ace run off the tableau in one move.
+typedef enum {
+  FOUND_BY_SUIT,
+  FOUND_RUN,
+} FoundationRule;
+
+// STOCK_DRAW turns cards up onto the waste; STOCK_DEAL deals one card onto every file.
+typedef enum {
+  STOCK_NONE,
+  STOCK_DRAW,
+  STOCK_DEAL,
+} StockRule;
+
+// Everything that tells the variants apart. The engine reads the rules from here instead of
+// having a copy of the move generator per variant.
+typedef struct {
+  const char *name;
+  uint8_t decks;
+  // Suits in play. The easier Spider deals count every black card as a spade and, with one suit,
+  // every red card too; see VariantSuit.
+  uint8_t suits;
+  uint8_t foundations;
+  uint8_t cells;
+  uint8_t tableau;
+  // Cards dealt to each file and how many of them end up face up.
+  uint8_t dealt[MAX_TABLEAU];
+  uint8_t faceUp[MAX_TABLEAU];
+  BuildRule build;
+  // What a group of cards picked up from the tableau has to be.
+  BuildRule group;
+  // FreeCell moves a group one card at a time through the free cells and empty files, so its
+  // size is limited by how many there are.
+  bool supermove;
+  EmptyRule empty;
+  FoundationRule foundation;
+  StockRule stock;
+} Variant;
+
+extern const Variant variants[VARIANT_COUNT];
+
+static inline Suit VariantSuit(const Variant *variant, Suit suit) {
+  if (variant->suits == 1) return SUIT_SPADES;
+  if (variant->suits == 2) return (suit == SUIT_DIAMONDS || suit == SUIT_HEARTS) ? SUIT_HEARTS : SUIT_SPADES;
+  return suit;
+}
+
+// The top of a pile is cards[count-1]. On the tableau the first `hidden` cards are face down; a
+// free cell holds at most one card.
+typedef struct {
+  uint8_t count;
+  uint8_t hidden;
+  CardId cards[PILE_CAPACITY];
+} Pile;
+
+// Stock and waste share one array. The waste is cards[0..wasteCount) with its top last, the stock
+// is cards[stockStart..count) and is drawn from the front. A draw copies at most three cards down
+// onto the end of the waste, playing from the waste shrinks wasteCount and a recycle makes the
+// waste the stock again, so none of them cost more with a bigger talon.
+typedef struct {
+  uint8_t count;
+  uint8_t wasteCount;
+  uint8_t stockStart;
+  CardId cards[TALON_CAPACITY];
+} Talon;
+
+// Where a card is: its pile and its index there, as ViewPile lists the pile.
+typedef struct {
+  uint8_t pile;
+  uint8_t index;
+} CardLocation;
+
+// A whole position. It owns no memory, so copying it is a plain struct assignment.
+typedef struct {
+  uint8_t variant;
+  uint8_t drawCount;
+  Talon talon;
+  Pile piles[PILE_COUNT];
+  // Kept up to date by ApplyMove for the cards it moves, so finding a card never scans the piles.
+  // A card in the talon is recorded as PILE_STOCK with its index into talon.cards; whether that
+  // is the stock or the waste is only worked out by LocateCard, so a recycle moves nothing here.
+  CardLocation locations[CARD_ID_LIMIT];
+  // Also kept by ApplyMove, so the whole-board questions are a mask or a compare instead of a
+  // loop over the piles. Bit t of hiddenFiles is set while tableau file t has face-down cards;
+  // nibble f of foundationHeights is the number of cards on foundation f, 13 at most.
+  uint16_t hiddenFiles;
+  uint32_t foundationHeights;
+  // Index in each tableau file of the deepest card that can be picked up with everything on it,
+  // 0 for an empty file, so move generation never walks the runs.
+  uint8_t groupStarts[MAX_TABLEAU];
+} Board;
+
+static inline const Variant *BoardVariant(const Board *board) { return &variants[board->variant]; }
+static inline size_t StockCount(const Board *board) { return board->talon.count - board->talon.stockStart; }
+static inline size_t WasteCount(const Board *board) { return board->talon.wasteCount; }
+static inline CardId WasteTop(const Board *board) { return board->talon.cards[board->talon.wasteCount-1]; }
+static inline size_t FoundationHeight(const Board *board, size_t foundation) { return (board->foundationHeights >> 4*foundation) & 15; }
+static inline bool HasHiddenCards(const Board *board) { return board->hiddenFiles != 0; }
+
+// Read-only look at any pile, the talon halves included. The stock is listed top first and all
+// of it is face down; every other pile is listed bottom first.
+typedef struct {
+  const CardId *cards;
+  size_t count;
+  size_t hidden;
+} PileView;
+
+PileView ViewPile(const Board *board, size_t pile);
+CardLocation LocateCard(const Board *board, CardId id);
+// Index of the deepest card of `pile` that can be picked up together with everything on it;
+// the pile's count when nothing can.
+size_t MovableFrom(const Board *board, size_t pile);
+
+typedef enum {
+  MOVE_DRAW,
+  MOVE_RECYCLE,
+  MOVE_DEAL,
+  MOVE_TRANSFER,
+  MOVE_KIND_COUNT
+} MoveKind;
+
+// MOVE_TRANSFER moves the top `count` cards of `from` onto `to`.
+typedef struct {
+  uint8_t kind;
+  uint8_t from;
+  uint8_t to;
+  uint8_t count;
+} Move;
+
+// Upper bound on the number of moves GenerateMoves can produce for a single position.
+#define MAX_MOVES 256
+
+static inline bool IsFoundation(size_t pile) { return pile < PILE_CELL; }
+static inline bool IsCell(size_t pile) { return pile >= PILE_CELL && pile < PILE_TABLEAU; }
+static inline bool IsTableau(size_t pile) { return pile >= PILE_TABLEAU && pile < PILE_COUNT; }
+
+// Deals `order` (the variant's decks times 52 card ids) file by file: the first file gets its
+// cards first, then the second and so on, as many as the variant's deal pattern says. The rest
+// becomes the stock, top first. Klondike turns up `drawCount` cards (1 or 3) per draw; the other
+// variants ignore it.
+bool DealBoard(Board *board, VariantKind variant, const CardId *order, size_t count, size_t drawCount);
+
+// Fills `moves` (which must hold MAX_MOVES entries) with every legal move and returns how many
+// there are. It never allocates. Moving a whole file onto an empty one is skipped, and of several
+// empty files or free cells only the first is offered as a target.
+size_t GenerateMoves(const Board *board, Move *moves);
+// The same moves in the same order, but with the rules read from the variant at run time instead
+// of from a copy of the generator specialized for it. Kept to measure the difference.
+size_t GenerateMovesGeneric(const Board *board, Move *moves);
+bool IsMoveLegal(const Board *board, Move move);
+// Applies a move without checking it and turns up a tableau card left uncovered by it.
+void ApplyMove(Board *board, Move move);
+bool IsBoardWon(const Board *board);
+// Only the cards in use are compared or hashed; slots above a pile's count may hold leftovers and
+// the location table is left out since it follows from the piles.
+bool BoardsEqual(const Board *a, const Board *b);
+uint64_t HashBoard(const Board *board);
+
+// Enough room for any auto-complete: each of the 52 foundation moves needs at most one pass
+// through the stock and waste before it.
+#define AUTO_COMPLETE_MAX_MOVES (CARDS_PER_DECK*(2*TALON_CAPACITY + 2))
+
+// True once every tableau card is face up, every file runs down from its bottom card and nothing
+// is left in the talon (Klondike drawing one excepted: every stock card comes up in turn). From
+// there the lowest card left is always on top of a file, in a cell or reachable in the stock, so
+// playing it to its foundation wins without any search. Never true for Spider.
+bool CanAutoComplete(const Board *board);
+// Plays the rest of the game to the foundations in one call. The moves are applied to `board` and
+// written to `moves` (which must hold AUTO_COMPLETE_MAX_MOVES entries) so they can be replayed on
+// screen. Returns how many there are.
+size_t AutoComplete(Board *board, Move *moves);
+// Spider: finds a finished king to ace run on the tableau, which is always worth taking off.
+bool FindCompletedRun(const Board *board, Move *move);
+
+// Batch evaluation for searches that look at many positions at once. The tableau tops of every
+// board are gathered as build keys, TOP_KEY_STRIDE bytes per board, so which files of which boards
+// take a card is a byte compare over the whole batch: 32 files at a time with AVX2, 16 with SSE2.
+// Files that are empty, face down or not in the variant hold TOP_KEY_NONE. All boards of a batch
+// must be of the same variant.
+#define TOP_KEY_STRIDE 16
+#define TOP_KEY_NONE 0xFF
+void GatherTopKeys(const Board *boards, size_t count, uint8_t *keys);
+// The key a card must match to go onto a file top.
+uint8_t CardBuildKey(const Board *board, CardId card);
+// masks[b] is the set of files of board b whose top takes the cards with `key`.
+void MatchTopKeys(const uint8_t *keys, size_t count, uint8_t key, uint16_t *masks);
+// The same answer with one compare per file, for machines without SIMD and for measuring.
+void MatchTopKeysScalar(const uint8_t *keys, size_t count, uint8_t key, uint16_t *masks);
+// The widest SIMD MatchTopKeys uses on this machine.
+const char *MatchTopKeysPath(void);
+
+// Deterministic splitmix64 generator, so deals can be reproduced from a seed on any thread.
+uint64_t NextRandom(uint64_t *state);
+void ShuffleCardIds(CardId *ids, size_t count, uint64_t *state);
+// Deals the variant's shoe shuffled from `seed`, so a game can be reproduced from the seed alone.
+bool DealSeed(Board *board, VariantKind variant, uint64_t seed, size_t drawCount);
+// Shuffles the cards the player cannot see (the face-down part of every file and the stock) among
+// their places: one guess at the hidden part of the position, for sampling it.
+void ShuffleHiddenCards(Board *board, uint64_t *state);
+
+#endif // ENGINE_H_
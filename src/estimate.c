@@ -0,0 +1,111 @@
+#define _POSIX_C_SOURCE 199309L
+#include <string.h>
+#include <unistd.h>
+
+#include "estimate.h"
+#include "platform.h"
+#include "../nob.h"
+
+static void *EstimateWorkerMain(void *arg) {
+  EstimateWorker *worker = arg;
+  Estimator *estimator = worker->estimator;
+  SolveLimits limits = { .maxNodes = ESTIMATE_PLAYOUT_NODES };
+  pthread_mutex_lock(&estimator->mutex);
+  while (estimator->running) {
+    if (!estimator->active) {
+      pthread_cond_wait(&estimator->wake, &estimator->mutex);
+      continue;
+    }
+    uint64_t generation = estimator->generation;
+    Board board = estimator->board;
+    pthread_mutex_unlock(&estimator->mutex);
+
+    size_t wins = 0;
+    size_t nodes = 0;
+    for (size_t p = 0; p < ESTIMATE_BATCH; ++p) {
+      Board sample = board;
+      ShuffleHiddenCards(&sample, &worker->random);
+      if (Solve(&worker->solver, &sample, limits, &worker->solution) == SOLVE_WON) wins++;
+      nodes += worker->solution.nodes;
+    }
+    if (estimator->nodes) CountStat(estimator->nodes, nodes);
+
+    pthread_mutex_lock(&estimator->mutex);
+    if (estimator->generation == generation) {
+      estimator->playouts += ESTIMATE_BATCH;
+      estimator->wins += wins;
+    }
+  }
+  pthread_mutex_unlock(&estimator->mutex);
+  return NULL;
+}
+
+bool StartEstimator(Estimator *estimator, _Atomic uint64_t *nodes) {
+  memset(estimator, 0, sizeof(*estimator));
+  estimator->nodes = nodes;
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t count = cores > 1 ? cores - 1 : 1;
+  if (count > ESTIMATE_MAX_WORKERS) count = ESTIMATE_MAX_WORKERS;
+  pthread_mutex_init(&estimator->mutex, NULL);
+  pthread_cond_init(&estimator->wake, NULL);
+  estimator->running = true;
+  for (size_t w = 0; w < count; ++w) {
+    EstimateWorker *worker = &estimator->workers[w];
+    worker->estimator = estimator;
+    worker->random = 0xE57 + w;
+    if (!InitSolver(&worker->solver, ESTIMATE_TABLE_BITS)) {
+      StopEstimator(estimator);
+      return false;
+    }
+    if (pthread_create(&worker->thread, NULL, EstimateWorkerMain, worker) != 0) {
+      nob_log(NOB_ERROR, "Could not start estimate worker %zu", w);
+      FreeSolver(&worker->solver);
+      StopEstimator(estimator);
+      return false;
+    }
+    estimator->workerCount++;
+  }
+  return true;
+}
+
+void StopEstimator(Estimator *estimator) {
+  if (!estimator->running) return;
+  pthread_mutex_lock(&estimator->mutex);
+  estimator->running = false;
+  pthread_cond_broadcast(&estimator->wake);
+  pthread_mutex_unlock(&estimator->mutex);
+  for (size_t w = 0; w < estimator->workerCount; ++w) {
+    pthread_join(estimator->workers[w].thread, NULL);
+    FreeSolver(&estimator->workers[w].solver);
+  }
+  estimator->workerCount = 0;
+  pthread_mutex_destroy(&estimator->mutex);
+  pthread_cond_destroy(&estimator->wake);
+}
+
+void EstimatePosition(Estimator *estimator, const Board *board) {
+  pthread_mutex_lock(&estimator->mutex);
+  estimator->board = *board;
+  estimator->generation++;
+  estimator->playouts = 0;
+  estimator->wins = 0;
+  estimator->since = NowSeconds();
+  estimator->active = true;
+  pthread_cond_broadcast(&estimator->wake);
+  pthread_mutex_unlock(&estimator->mutex);
+}
+
+void PauseEstimator(Estimator *estimator) {
+  pthread_mutex_lock(&estimator->mutex);
+  estimator->active = false;
+  pthread_mutex_unlock(&estimator->mutex);
+}
+
+Estimate ReadEstimate(Estimator *estimator) {
+  pthread_mutex_lock(&estimator->mutex);
+  Estimate estimate = { .playouts = estimator->playouts, .wins = estimator->wins };
+  double elapsed = NowSeconds() - estimator->since;
+  if (elapsed > 0) estimate.playoutsPerSecond = estimator->playouts/elapsed;
+  pthread_mutex_unlock(&estimator->mutex);
+  return estimate;
+}
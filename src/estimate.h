@@ -0,0 +1,63 @@
+#ifndef ESTIMATE_H_
+#define ESTIMATE_H_
+
+#include <pthread.h>
+
+#include "solver.h"
+#include "stats.h"
+
+// Estimates the chance to win from a position by sampling it: every playout deals the face-down
+// cards again at random and gives the solver a small budget to win the result. Workers take their
+// own copy of the position and only touch the shared counters between batches, so they never wait
+// on each other. The estimate leans optimistic where the hidden cards matter, since each sample is
+// played with them known, and pessimistic where the budget runs out.
+
+#define ESTIMATE_MAX_WORKERS 16
+#define ESTIMATE_PLAYOUT_NODES 2000
+#define ESTIMATE_TABLE_BITS 13
+// Playouts a worker runs between looks at the shared state.
+#define ESTIMATE_BATCH 8
+
+typedef struct Estimator Estimator;
+
+typedef struct {
+  pthread_t thread;
+  Estimator *estimator;
+  uint64_t random;
+  Solver solver;
+  Solution solution;
+} EstimateWorker;
+
+struct Estimator {
+  pthread_mutex_t mutex;
+  pthread_cond_t wake;
+  bool running;
+  // Playouts only run while someone is looking at the estimate.
+  bool active;
+  Board board;
+  // Bumped with every new position so batches of the old one are thrown away.
+  uint64_t generation;
+  size_t playouts;
+  size_t wins;
+  double since;
+  size_t workerCount;
+  EstimateWorker workers[ESTIMATE_MAX_WORKERS];
+  // Where the nodes searched are counted, when anyone is counting.
+  _Atomic uint64_t *nodes;
+};
+
+typedef struct {
+  size_t playouts;
+  size_t wins;
+  double playoutsPerSecond;
+} Estimate;
+
+// Starts a worker per core but one, which is left to the frame loop.
+bool StartEstimator(Estimator *estimator, _Atomic uint64_t *nodes);
+void StopEstimator(Estimator *estimator);
+// Starts sampling `board` over; never blocks on the workers.
+void EstimatePosition(Estimator *estimator, const Board *board);
+void PauseEstimator(Estimator *estimator);
+Estimate ReadEstimate(Estimator *estimator);
+
+#endif // ESTIMATE_H_
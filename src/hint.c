@@ -0,0 +1,103 @@
+#include <string.h>
+
+#include "hint.h"
+#include "../nob.h"
+
+// Looks for `board` on the cached line and, if it is there, answers with the move that follows it.
+// Called with the mutex held.
+static bool AnswerFromLine(Hinter *hinter, const Board *board) {
+  if (hinter->line.count == 0) return false;
+  Board at = hinter->lineStart;
+  for (size_t i = 0; i < hinter->line.count; ++i) {
+    if (BoardsEqual(&at, board)) {
+      hinter->found = true;
+      hinter->hint = hinter->line.moves[i];
+      hinter->answered = hinter->requested;
+      return true;
+    }
+    ApplyMove(&at, hinter->line.moves[i]);
+  }
+  return false;
+}
+
+static void *HintWorker(void *arg) {
+  Hinter *hinter = arg;
+  // The line is searched into a buffer only the worker touches and copied over once done.
+  Solution *solution = &hinter->scratch;
+  pthread_mutex_lock(&hinter->mutex);
+  while (hinter->running) {
+    if (hinter->answered == hinter->requested) {
+      pthread_cond_wait(&hinter->wake, &hinter->mutex);
+      continue;
+    }
+    uint64_t id = hinter->requested;
+    Board board = hinter->request;
+    pthread_mutex_unlock(&hinter->mutex);
+
+    SolveLimits limits = { .seconds = HINT_BUDGET_SECONDS };
+    Solve(&hinter->solver, &board, limits, solution);
+    if (hinter->nodes) CountStat(hinter->nodes, solution->nodes);
+
+    pthread_mutex_lock(&hinter->mutex);
+    hinter->lineStart = board;
+    memcpy(hinter->line.moves, solution->moves, solution->count*sizeof(Move));
+    hinter->line.count = solution->count;
+    hinter->line.result = solution->result;
+    if (hinter->requested == id) {
+      hinter->found = solution->count > 0;
+      if (hinter->found) hinter->hint = solution->moves[0];
+      hinter->answered = id;
+    }
+  }
+  pthread_mutex_unlock(&hinter->mutex);
+  return NULL;
+}
+
+bool StartHinter(Hinter *hinter, _Atomic uint64_t *nodes) {
+  memset(hinter, 0, sizeof(*hinter));
+  hinter->nodes = nodes;
+  if (!InitSolver(&hinter->solver, HINT_TABLE_BITS)) return false;
+  pthread_mutex_init(&hinter->mutex, NULL);
+  pthread_cond_init(&hinter->wake, NULL);
+  hinter->running = true;
+  if (pthread_create(&hinter->thread, NULL, HintWorker, hinter) != 0) {
+    nob_log(NOB_ERROR, "Could not start the hint worker");
+    hinter->running = false;
+    FreeSolver(&hinter->solver);
+    return false;
+  }
+  return true;
+}
+
+void StopHinter(Hinter *hinter) {
+  if (!hinter->running) return;
+  pthread_mutex_lock(&hinter->mutex);
+  hinter->running = false;
+  pthread_cond_signal(&hinter->wake);
+  pthread_mutex_unlock(&hinter->mutex);
+  pthread_join(hinter->thread, NULL);
+  pthread_mutex_destroy(&hinter->mutex);
+  pthread_cond_destroy(&hinter->wake);
+  FreeSolver(&hinter->solver);
+}
+
+void RequestHint(Hinter *hinter, const Board *board) {
+  pthread_mutex_lock(&hinter->mutex);
+  hinter->requested++;
+  if (!AnswerFromLine(hinter, board)) {
+    hinter->request = *board;
+    pthread_cond_signal(&hinter->wake);
+  }
+  pthread_mutex_unlock(&hinter->mutex);
+}
+
+bool PollHint(Hinter *hinter, bool *found, Move *move) {
+  pthread_mutex_lock(&hinter->mutex);
+  bool ready = hinter->answered == hinter->requested;
+  if (ready) {
+    *found = hinter->found;
+    *move = hinter->hint;
+  }
+  pthread_mutex_unlock(&hinter->mutex);
+  return ready;
+}
@@ -0,0 +1,46 @@
+#ifndef HINT_H_
+#define HINT_H_
+
+#include <pthread.h>
+
+#include "solver.h"
+#include "stats.h"
+
+// Hints are searched on a worker thread so the frame loop never waits for the solver. The last
+// line found is kept: while the player keeps following it, the next hint is read off the line
+// without searching again.
+
+#define HINT_BUDGET_SECONDS 0.02
+#define HINT_TABLE_BITS 18
+
+typedef struct {
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t wake;
+  bool running;
+
+  // Latest position asked about; only searched once the worker picks it up.
+  Board request;
+  uint64_t requested;
+  uint64_t answered;
+  bool found;
+  Move hint;
+
+  // The last line searched and the position it starts from.
+  Board lineStart;
+  Solution line;
+
+  Solver solver;
+  Solution scratch;
+  // Where the nodes searched are counted, when anyone is counting.
+  _Atomic uint64_t *nodes;
+} Hinter;
+
+bool StartHinter(Hinter *hinter, _Atomic uint64_t *nodes);
+void StopHinter(Hinter *hinter);
+// Never blocks on the search. Answers at once when the position is on the cached line.
+void RequestHint(Hinter *hinter, const Board *board);
+// True once the latest request is answered; `move` is set when there is anything to play.
+bool PollHint(Hinter *hinter, bool *found, Move *move);
+
+#endif // HINT_H_
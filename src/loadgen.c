@@ -0,0 +1,181 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define NOB_IMPLEMENTATION
+#include "../nob.h"
+
+#include "engine.h"
+#include "protocol.h"
+#include "platform.h"
+
+// Drives the game server with many sessions at once and measures it:
+//
+//   ./build/loadgen [sessions] [seconds] [socket path | port] [variant]
+//
+// Every session deals a game and then plays random moves from the ones the server lists, dealing
+// again when the game is over, with one request in flight at a time. The time from sending a
+// request to having its whole response is recorded per request, and the run ends with the
+// throughput and the latency percentiles.
+
+#define LOADGEN_MAX_SESSIONS 16384
+#define LOADGEN_MAX_EVENTS 256
+#define LOADGEN_MAX_PLIES 500
+// Latencies are counted per microsecond up to this; slower requests share the last bucket.
+#define LATENCY_BUCKETS 1000000
+
+typedef struct {
+  int fd;
+  uint64_t random;
+  uint8_t in[RESPONSE_MAX];
+  size_t inCount;
+  double sentAt;
+} Client;
+
+static int Connect(const char *where) {
+  char *end;
+  long port = strtol(where, &end, 10);
+  int fd;
+  if (*where != '\0' && *end == '\0') {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if (fd >= 0 && connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  } else {
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strncpy(address.sun_path, where, sizeof(address.sun_path) - 1);
+    if (fd >= 0 && connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  if (fd < 0) nob_log(NOB_ERROR, "Could not connect to %s: %s", where, strerror(errno));
+  return fd;
+}
+
+// Requests are 16 bytes, so the socket buffer always takes one whole.
+static bool Send(Client *client, Request request) {
+  client->sentAt = NowSeconds();
+  client->inCount = 0;
+  return write(client->fd, &request, sizeof(request)) == sizeof(request);
+}
+
+static size_t ResponseSize(const Client *client) {
+  if (client->inCount < sizeof(ResponseHeader)) return sizeof(ResponseHeader);
+  ResponseHeader header;
+  memcpy(&header, client->in, sizeof(header));
+  return sizeof(header) + header.moveCount*sizeof(Move);
+}
+
+static double Percentile(const uint32_t *latencies, size_t total, double fraction) {
+  size_t target = total*fraction;
+  size_t seen = 0;
+  for (size_t us = 0; us < LATENCY_BUCKETS; ++us) {
+    seen += latencies[us];
+    if (seen > target) return us;
+  }
+  return LATENCY_BUCKETS;
+}
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000;
+  double seconds = argc > 2 ? strtod(argv[2], NULL) : 10;
+  const char *where = argc > 3 ? argv[3] : SERVER_SOCKET;
+  VariantKind variant = argc > 4 ? strtoull(argv[4], NULL, 10) : VARIANT_KLONDIKE;
+  if (count < 1 || count > LOADGEN_MAX_SESSIONS || variant >= VARIANT_COUNT) {
+    nob_log(NOB_ERROR, "usage: loadgen [sessions up to %d] [seconds] [socket path | port] [variant]", LOADGEN_MAX_SESSIONS);
+    return 1;
+  }
+  RaiseFileLimit();
+
+  Client *clients = calloc(count, sizeof(*clients));
+  static uint32_t latencies[LATENCY_BUCKETS];
+  int epoll = epoll_create1(0);
+  if (!clients || epoll < 0) {
+    nob_log(NOB_ERROR, "Could not set up %zu sessions", count);
+    return 1;
+  }
+  for (size_t c = 0; c < count; ++c) {
+    Client *client = &clients[c];
+    client->fd = Connect(where);
+    if (client->fd < 0) return 1;
+    fcntl(client->fd, F_SETFL, fcntl(client->fd, F_GETFL, 0) | O_NONBLOCK);
+    client->random = 0x10AD + c;
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = c };
+    epoll_ctl(epoll, EPOLL_CTL_ADD, client->fd, &event);
+  }
+
+  Request deal = { .op = OP_NEW, .variant = variant, .drawCount = 1 };
+  double start = NowSeconds();
+  for (size_t c = 0; c < count; ++c) {
+    deal.seed = NextRandom(&clients[c].random);
+    if (!Send(&clients[c], deal)) return 1;
+  }
+
+  struct epoll_event events[LOADGEN_MAX_EVENTS];
+  size_t requests = 0;
+  size_t games = 0;
+  size_t won = 0;
+  double slowest = 0;
+  while (NowSeconds() - start < seconds) {
+    int n = epoll_wait(epoll, events, LOADGEN_MAX_EVENTS, 100);
+    for (int e = 0; e < n; ++e) {
+      Client *client = &clients[events[e].data.u32];
+      ssize_t got = read(client->fd, client->in + client->inCount, ResponseSize(client) - client->inCount);
+      if (got <= 0) {
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+        nob_log(NOB_ERROR, "The server closed a session");
+        return 1;
+      }
+      client->inCount += got;
+      if (client->inCount < ResponseSize(client)) continue;
+
+      double latency = NowSeconds() - client->sentAt;
+      size_t us = latency*1e6;
+      latencies[us < LATENCY_BUCKETS ? us : LATENCY_BUCKETS - 1]++;
+      if (latency > slowest) slowest = latency;
+      requests++;
+
+      ResponseHeader header;
+      memcpy(&header, client->in, sizeof(header));
+      if (header.status != STATUS_OK) {
+        nob_log(NOB_ERROR, "The server answered with status %d", header.status);
+        return 1;
+      }
+      Request request;
+      if (header.won || header.moveCount == 0 || header.plies >= LOADGEN_MAX_PLIES) {
+        games++;
+        won += header.won;
+        request = deal;
+        request.seed = NextRandom(&client->random);
+      } else {
+        request = (Request) { .op = OP_MOVE };
+        memcpy(&request.move, client->in + sizeof(header) + NextRandom(&client->random) % header.moveCount*sizeof(Move), sizeof(Move));
+      }
+      if (!Send(client, request)) {
+        nob_log(NOB_ERROR, "Could not send a request");
+        return 1;
+      }
+    }
+  }
+  double elapsed = NowSeconds() - start;
+
+  printf("loadgen: %zu sessions, %.0f requests/s, %zu games (%zu won)\n", count, requests/elapsed, games, won);
+  printf("loadgen: latency p50 %.0f us, p99 %.0f us, p99.9 %.0f us, max %.0f us\n",
+         Percentile(latencies, requests, 0.5), Percentile(latencies, requests, 0.99),
+         Percentile(latencies, requests, 0.999), slowest*1e6);
+  for (size_t c = 0; c < count; ++c) close(clients[c].fd);
+  free(clients);
+  close(epoll);
+  return 0;
+}
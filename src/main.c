@@ -1,3 +1,5 @@
+#include <time.h>
+
 #include "raylib.h"
 #include "raymath.h"
 
@@ -7,6 +9,15 @@
 #define NOB_IMPLEMENTATION
 #include "../nob.h"
 
+#include "engine.h"
+#include "hint.h"
+#include "estimate.h"
+#include "save.h"
+#include "dealdb.h"
+#include "stats.h"
+#include "pacing.h"
+#include "prefetch.h"
+
 #if 0
 #define SCREEN_WIDTH 2140 
 #define SCREEN_HEIGHT 1440
@@ -25,35 +36,17 @@
 #define CARD_WIDTH (SRC_CARD_WIDTH*SRC_CARD_SCALE+10)
 #define CARD_HEIGHT (SRC_CARD_HEIGHT*SRC_CARD_SCALE)
 
-#define FILES_COUNT 7
 #define PILES_WIDTH CARD_WIDTH*1.25
 #define PILES_HEIGHT CARD_HEIGHT*1.15
 #define PILES_SPACING 20
 
-typedef enum {
-  SUIT_CLUBS,
-  SUIT_DIAMONDS,
-  SUIT_HEARTS,
-  SUIT_SPADES,
-  SUIT_COUNT
-} Suit;
-
-typedef enum {
-  VAL_ACE = 1,
-  VAL_TWO,
-  VAL_THREE,
-  VAL_FOUR,
-  VAL_FIVE,
-  VAL_SIX,
-  VAL_SEVEN,
-  VAL_EIGHT,
-  VAL_NINE,
-  VAL_TEN,
-  VAL_JACK,
-  VAL_QUEEN,
-  VAL_KING,
-  VAL_COUNT
-} Value;
+// How fast cards glide to their place, and how long each auto-complete move stays on screen.
+#define CARD_GLIDE_SPEED 18.0f
+#define AUTO_COMPLETE_STEP 0.06f
+// Horizontal offset between the waste cards fanned out when drawing three.
+#define WASTE_FAN_SPACING 25
+// The game in progress, appended to on every move and picked back up on the next start.
+#define SAVE_PATH "ccards.save"
 
 typedef enum {
   BC_RED,
@@ -68,10 +61,13 @@ typedef enum {
   DECK_STD,
   DECK_DISCARD,
   DECK_FILE,
+  DECK_FOUNDATION,
+  DECK_CELL,
   DECK_COUNT
 } DeckKind;
 
 typedef struct {
+  CardId id;
   Suit suit;
   Value value;
   Rectangle source;
@@ -82,13 +78,14 @@ typedef struct {
   bool moved;
 } Card;
 
+// Decks hold their cards in place, like the board's piles, so the whole game state is one block
+// that is never reallocated and a new game allocates nothing.
 typedef struct {
-  Card *items;
-  size_t capacity;
+  Card items[PILE_CAPACITY];
   size_t count;
   DeckKind kind;
+  PileIndex pile;
   Vector2 position;
-  Vector2 cardStart;
   Rectangle bounds;
 } Deck;
 
@@ -108,12 +105,38 @@ typedef struct {
   Back value;
 } Backs;
 
+// A row of decks: the tableau, the foundations or the free cells.
+#define DECK_ROW_MAX MAX_TABLEAU
+_Static_assert(MAX_FOUNDATIONS <= DECK_ROW_MAX && MAX_CELLS <= DECK_ROW_MAX, "every row of piles must fit in a DeckFiles");
+
 typedef struct {
-  Deck *items;
-  size_t capacity;
+  Deck items[DECK_ROW_MAX];
   size_t count;
 } DeckFiles;
 
+// The cards being dragged: the grabbed card and everything on it. They stay where they are in
+// their deck and are addressed by index, so picking up a run copies nothing.
+typedef struct {
+  Deck *deck;
+  size_t start;
+  size_t count;
+  // Where on the grabbed card the pointer took hold of it.
+  Vector2 grab;
+  // With prediction on, the cards are drawn `lead` ahead of where they are, towards where the
+  // pointer is headed at `velocity`.
+  Vector2 velocity;
+  Vector2 lead;
+} CardSlice;
+
+// Moves that were already applied to the board but are still being played out on screen.
+typedef struct {
+  Move moves[AUTO_COMPLETE_MAX_MOVES];
+  size_t count;
+  size_t next;
+  float timer;
+  Board board;
+} Replay;
+
 typedef struct {
   Deck deck;
   Deck drawn;
@@ -122,35 +145,80 @@ typedef struct {
   Backs *backs;
   Back *activeBack;
   DeckFiles files;
+  DeckFiles foundations;
+  DeckFiles cells;
   Deck *hoveredFile;
-  Deck *homeFile;
+  CardSlice drag;
+  Board board;
+  Replay replay;
+  Vector2 cardPositions[CARD_ID_LIMIT];
+  Move hint;
+  bool hintPending;
+  bool hintShown;
+  // W shows the estimated chance to win; `estimated` is the position the estimate is for.
+  bool estimating;
+  Board estimated;
+  // The game is the deal's card order plus the moves played on it, which is also what gets saved.
+  CardId order[MAX_CARDS];
+  size_t cardCount;
+  uint64_t random;
+  MoveJournal journal;
+  SaveFile save;
+  // A new game's save is started on the frame after the deal, so dealing does no file I/O.
+  bool savePending;
+  Stats *stats;
+  // Set once the game has gone into the stats, so it is never counted twice.
+  bool finished;
+  // Random deals come ready from here; `verdict` is what its solver made of this one.
+  Prefetcher *prefetcher;
+  SolveResult verdict;
+  // The draw count picked with D, kept while variants without a stock to draw from are played.
+  size_t drawChoice;
 } GameState;
 
-bool CreateSTDDeck(Deck *deck) {
+Rectangle CardSource(Suit s, Value v) {
+  return CLITERAL(Rectangle) { 
+    .x = (v-1) * (SRC_CARD_WIDTH + SRC_CARD_SPACING_X), 
+    .y = s * (SRC_CARD_HEIGHT + SRC_CARD_SPACING_Y), 
+    .width = SRC_CARD_WIDTH, 
+    .height = SRC_CARD_HEIGHT 
+  };
+}
+
+Card CardFromId(CardId id) {
+  Suit s = CardIdSuit(id);
+  Value v = CardIdValue(id);
+  Rectangle src = CardSource(s, v);
+  Rectangle bounds = { .x = 0, .y = 0, .width = CARD_WIDTH, .height = CARD_HEIGHT };
+  Card c = { 
+    .id = id,
+    .suit = s, 
+    .value = v,
+    .source = src,
+    .bounds = bounds,
+    .drawn = false,
+    .flipped = false,
+  };
+  return c;
+}
+
+// Fills the deck with a shoe of `decks` standard decks. Every card gets an id of its own, so the
+// copies of a card in a multi-deck shoe never get mixed up.
+bool CreateSTDDeck(Deck *deck, size_t decks) {
   if (deck->kind != DECK_STD) {
     nob_log(NOB_ERROR, "Invalid deck kind for CreateSTDDeck");
     return false;
   }
-  for (int s = SUIT_CLUBS; s < SUIT_COUNT; ++s) {
-    for (int v = VAL_ACE; v < VAL_COUNT; ++v) {
-      Rectangle src = { 
-        .x = (v-1) * (SRC_CARD_WIDTH + SRC_CARD_SPACING_X), 
-        .y = s * (SRC_CARD_HEIGHT + SRC_CARD_SPACING_Y), 
-        .width = SRC_CARD_WIDTH, 
-        .height = SRC_CARD_HEIGHT 
-      };
-      Rectangle bounds = { .x = 0, .y = 0, .width = CARD_WIDTH, .height = CARD_HEIGHT };
-      Card c = { 
-        .suit = s, 
-        .value = v,
-        .source = src,
-        .bounds = bounds,
-        .drawn = false,
-        .flipped = false,
-      };
-      nob_da_append(deck, c);
-    }
+  if (decks == 0 || decks > MAX_DECKS) {
+    nob_log(NOB_ERROR, "Invalid deck count for CreateSTDDeck: %zu", decks);
+    return false;
+  }
+  CardId ids[MAX_CARDS];
+  size_t count = FillShoe(ids, decks);
+  for (size_t c = 0; c < count; ++c) {
+    deck->items[c] = CardFromId(ids[c]);
   }
+  deck->count = count;
   return true;
 }
 
@@ -179,59 +247,6 @@ void DrawHoveredOutline(Rectangle bounds) {
   DrawRectangleLinesEx(bounds, 5, LIME);
 }
 
-Card *GetNextCard(Deck *src, Deck *dest) {
-  nob_da_append(dest, src->items[0]);
-  src->count--;
-  if (src->count == 0) return &dest->items[dest->count-1];
-  for (size_t c = 1; c < src->count-1; ++c) {
-    src->items[c-1] = src->items[c];
-  }
-  return &dest->items[dest->count-1];
-}
-
-void AddCardToDeck(Card *card, Deck *deck) {
-  nob_da_append(deck, *card); 
-}
-
-void RemoveCardFromDeck(Card *cardToRemove, Deck *deck) {
-  Deck temp = {0};
-  for (size_t c = 0; c < deck->count; ++c) {
-    Card card = deck->items[c];
-    if (card.suit != cardToRemove->suit && card.value != cardToRemove->value)
-      nob_da_append(&temp, card);
-  }
-  deck->count = 0;
-  for (size_t c= 0; c < temp.count; ++c) {
-    nob_da_append(deck, temp.items[c]);
-  }
-}
-
-Card *GetRandomCard(Deck *deck) {
-  Card *card = NULL;
-  while (!card) {
-    int v = GetRandomValue(0, deck->count);
-    if (!deck->items[v].drawn) {
-      card = &deck->items[v];
-      card->drawn = true;
-      break;
-    }
-  }
-  return card;
-}
-
-void ShuffleDeck(Deck *deck) {
-  Deck temp = {0};
-  for (size_t c = 0; c < deck->count; ++c) {
-    Card *card = GetRandomCard(deck);
-    nob_da_append(&temp, *card);
-  }
-  deck->count = 0;
-  for (size_t c = 0; c < temp.count; ++c) {
-    Card card = temp.items[c];
-    nob_da_append(deck, card);
-  }
-}
-
 const char* sizetToString(size_t num, size_t len) {
   char* buffer = (char*)malloc((len+1)*sizeof(char));
   if (!buffer) return NULL;
@@ -240,11 +255,7 @@ const char* sizetToString(size_t num, size_t len) {
 }
 
 void UpdatePosition(Card *card, Vector2 delta) {
-  if (!card->moved) {
-    card->origPos.x = card->bounds.x;
-    card->origPos.y = card->bounds.y;
-    card->moved = true;
-  }
+  card->moved = true;
   Vector2 pos = { .x = card->bounds.x, .y = card->bounds.y };
   pos = Vector2Add(pos, delta);
   card->bounds.x = pos.x;
@@ -264,62 +275,568 @@ void SetPosition(Card *card, Vector2 pos) {
   card->origPos.y = pos.y;
 }
 
-int main(void) {
+// `count` is the number of cards the deck will hold once it is rebuilt.
+Vector2 DeckCardPosition(GameState *gs, Deck *deck, size_t index, size_t count) {
+  switch (deck->kind) {
+    case DECK_DISCARD: {
+      // The top drawCount cards of the waste are fanned out, whichever draws they came from; the
+      // ones under them stay stacked.
+      size_t fanned = count < gs->board.drawCount ? count : gs->board.drawCount;
+      size_t slot = index + fanned >= count ? index + fanned - count : 0;
+      return CLITERAL(Vector2) { .x = deck->bounds.x + deck->bounds.width + 25 + WASTE_FAN_SPACING*slot, .y = gs->activeBack->bounds.y };
+    }
+    case DECK_FILE: {
+      // Long files (Spider and Yukon get them) are squeezed so they stay on screen.
+      float top = deck->position.y + (PILES_HEIGHT-CARD_HEIGHT)/2;
+      float spacing = PILES_SPACING * 2;
+      if (count > 1) spacing = Clamp((SCREEN_HEIGHT - top - CARD_HEIGHT - 10)/(count-1), 0, spacing);
+      return CLITERAL(Vector2) { 
+        .x = deck->position.x + (PILES_WIDTH-CARD_WIDTH)/2,
+        .y = top + spacing * index
+      };
+    }
+    case DECK_FOUNDATION:
+    case DECK_CELL:
+      return CLITERAL(Vector2) { 
+        .x = deck->position.x + (PILES_WIDTH-CARD_WIDTH)/2,
+        .y = deck->position.y + (PILES_HEIGHT-CARD_HEIGHT)/2
+      };
+    default:
+      return CLITERAL(Vector2) { .x = gs->activeBack->bounds.x, .y = gs->activeBack->bounds.y };
+  }
+}
+
+bool IsReplaying(GameState *gs) {
+  return gs->replay.next < gs->replay.count;
+}
+
+// While an auto-complete is being played out the screen lags behind the board.
+const Board *ShownBoard(GameState *gs) {
+  return IsReplaying(gs) ? &gs->replay.board : &gs->board;
+}
+
+// Card `c` of the pile in `view` as it is drawn, at its place in `deck`.
+Card PileCard(GameState *gs, const Board *board, Deck *deck, PileView view, size_t c) {
+  Card card = CardFromId(view.cards[c]);
+  // The easier Spider deals show every card in the suits that are in play.
+  card.suit = VariantSuit(BoardVariant(board), card.suit);
+  card.source = CardSource(card.suit, card.value);
+  card.flipped = c >= view.hidden;
+  SetPosition(&card, DeckCardPosition(gs, deck, c, view.count));
+  return card;
+}
+
+// The board is the source of truth; decks are rebuilt from it after every move so they only carry
+// what is needed to draw and drag the cards. A card starts from wherever it was last drawn and
+// glides to its new place.
+void SyncDeck(GameState *gs, Deck *deck) {
+  const Board *board = ShownBoard(gs);
+  PileView view = ViewPile(board, deck->pile);
+  for (size_t c = 0; c < view.count; ++c) {
+    Card card = PileCard(gs, board, deck, view, c);
+    card.bounds.x = gs->cardPositions[card.id].x;
+    card.bounds.y = gs->cardPositions[card.id].y;
+    deck->items[c] = card;
+  }
+  deck->count = view.count;
+}
+
+void SyncDecks(GameState *gs) {
+  SyncDeck(gs, &gs->deck);
+  SyncDeck(gs, &gs->drawn);
+  for (size_t f = 0; f < gs->foundations.count; ++f) {
+    SyncDeck(gs, &gs->foundations.items[f]);
+  }
+  for (size_t c = 0; c < gs->cells.count; ++c) {
+    SyncDeck(gs, &gs->cells.items[c]);
+  }
+  for (size_t f = 0; f < gs->files.count; ++f) {
+    SyncDeck(gs, &gs->files.items[f]);
+  }
+}
+
+bool IsDragged(GameState *gs, Card *card) {
+  CardSlice *drag = &gs->drag;
+  return drag->deck && card >= drag->deck->items + drag->start && card < drag->deck->items + drag->start + drag->count;
+}
+
+void GlideDeck(GameState *gs, Deck *deck, float t) {
+  for (size_t c = 0; c < deck->count; ++c) {
+    Card *card = &deck->items[c];
+    Vector2 pos = { .x = card->bounds.x, .y = card->bounds.y };
+    if (!IsDragged(gs, card)) pos = Vector2Lerp(pos, card->origPos, t);
+    card->bounds.x = pos.x;
+    card->bounds.y = pos.y;
+    gs->cardPositions[card->id] = pos;
+  }
+}
+
+void GlideDecks(GameState *gs, float dt) {
+  float t = Clamp(dt*CARD_GLIDE_SPEED, 0, 1);
+  GlideDeck(gs, &gs->deck, t);
+  GlideDeck(gs, &gs->drawn, t);
+  for (size_t f = 0; f < gs->foundations.count; ++f) {
+    GlideDeck(gs, &gs->foundations.items[f], t);
+  }
+  for (size_t c = 0; c < gs->cells.count; ++c) {
+    GlideDeck(gs, &gs->cells.items[c], t);
+  }
+  for (size_t f = 0; f < gs->files.count; ++f) {
+    GlideDeck(gs, &gs->files.items[f], t);
+  }
+}
+
+void UpdateReplay(GameState *gs, float dt) {
+  if (!IsReplaying(gs)) return;
+  gs->replay.timer += dt;
+  while (gs->replay.timer >= AUTO_COMPLETE_STEP && IsReplaying(gs)) {
+    gs->replay.timer -= AUTO_COMPLETE_STEP;
+    ApplyMove(&gs->replay.board, gs->replay.moves[gs->replay.next++]);
+    SyncDecks(gs);
+  }
+}
+
+Deck *DeckOfPile(GameState *gs, size_t pile) {
+  if (pile == PILE_STOCK) return &gs->deck;
+  if (pile == PILE_WASTE) return &gs->drawn;
+  if (IsFoundation(pile)) return &gs->foundations.items[pile - PILE_FOUNDATION];
+  if (IsCell(pile)) return &gs->cells.items[pile - PILE_CELL];
+  return &gs->files.items[pile - PILE_TABLEAU];
+}
+
+Deck *FindDeckOfCard(GameState *gs, Card *card) {
+  return DeckOfPile(gs, LocateCard(ShownBoard(gs), card->id).pile);
+}
+
+// Outlines the cards the hint moves and the place they go to.
+void DrawHint(GameState *gs) {
+  Move move = gs->hint;
+  if (move.kind != MOVE_TRANSFER) {
+    DrawHoveredOutline(gs->drawn.bounds);
+    return;
+  }
+  Deck *src = DeckOfPile(gs, move.from);
+  Deck *dst = DeckOfPile(gs, move.to);
+  if (src->count >= move.count) DrawHoveredOutline(src->items[src->count - move.count].bounds);
+  if (dst->count > 0) {
+    DrawHoveredOutline(dst->items[dst->count-1].bounds);
+  } else {
+    DrawHoveredOutline(CLITERAL(Rectangle) { .x = dst->position.x, .y = dst->position.y, .width = PILES_WIDTH, .height = PILES_HEIGHT });
+  }
+}
+
+// Applies a move the player made together with whatever the rules do on their own after it.
+void PlayMove(GameState *gs, Move move) {
+  ApplyMove(&gs->board, move);
+  gs->hintPending = false;
+  gs->hintShown = false;
+  // Spider takes a finished run off the tableau as soon as it is complete.
+  Move run;
+  while (FindCompletedRun(&gs->board, &run)) ApplyMove(&gs->board, run);
+  if (CanAutoComplete(&gs->board)) {
+    gs->replay.board = gs->board;
+    gs->replay.count = AutoComplete(&gs->board, gs->replay.moves);
+    gs->replay.next = 0;
+    gs->replay.timer = 0;
+  }
+}
+
+bool TryMove(GameState *gs, Move move) {
+  if (!IsMoveLegal(&gs->board, move)) return false;
+  PlayMove(gs, move);
+  nob_da_append(&gs->journal, move);
+  // A save still to be started writes the whole journal when it is.
+  if (!gs->savePending) AppendMove(&gs->save, move);
+  SyncDecks(gs);
+  CountStat(&gs->stats->player.moves, 1);
+  CountStat(&gs->stats->process.moves, 1);
+  if (!gs->finished && IsBoardWon(&gs->board)) {
+    CountGame(gs->stats, true);
+    gs->finished = true;
+  }
+  return true;
+}
+
+// Picks up `card` with everything on it, as long as the rules let that group move at all.
+bool StartDrag(GameState *gs, Card *card, Vector2 mouse) {
+  Deck *deck = FindDeckOfCard(gs, card);
+  if (!deck) return false;
+  size_t index = card - deck->items;
+  if (index < MovableFrom(&gs->board, deck->pile)) return false;
+  gs->activeCard = card;
+  Vector2 grab = { .x = mouse.x - card->bounds.x, .y = mouse.y - card->bounds.y };
+  gs->drag = CLITERAL(CardSlice) { .deck = deck, .start = index, .count = deck->count - index, .grab = grab };
+  return true;
+}
+
+// Predictive dragging draws the cards where the pointer should be when the frame is presented
+// instead of where it was polled, a frame earlier: its velocity, smoothed over the last few frames,
+// carried over one frame. The lead is capped so a sudden stop does not fling the cards far past
+// the pointer. Only the drawing leads; dropping still goes by the pointer itself.
+#define DRAG_SMOOTHING 0.5f
+#define DRAG_MAX_LEAD 48.0f
+
+void DragCards(GameState *gs, Vector2 delta, float dt, bool predict) {
+  for (size_t c = gs->drag.start; c < gs->drag.start + gs->drag.count; ++c) {
+    UpdatePosition(&gs->drag.deck->items[c], delta);
+  }
+  gs->drag.lead = Vector2Zero();
+  if (!predict || dt <= 0) return;
+  gs->drag.velocity = Vector2Lerp(gs->drag.velocity, Vector2Scale(delta, 1/dt), DRAG_SMOOTHING);
+  Vector2 lead = Vector2Scale(gs->drag.velocity, dt);
+  float length = Vector2Length(lead);
+  if (length > DRAG_MAX_LEAD) lead = Vector2Scale(lead, DRAG_MAX_LEAD/length);
+  gs->drag.lead = lead;
+}
+
+// Drops the dragged cards on `target`; without a legal move there they go back where they were.
+void EndDrag(GameState *gs, Deck *target) {
+  CardSlice drag = gs->drag;
+  gs->activeCard = NULL;
+  gs->drag = CLITERAL(CardSlice) {0};
+  if (target) {
+    Move move = { .kind = MOVE_TRANSFER, .from = drag.deck->pile, .to = target->pile, .count = drag.count };
+    if (TryMove(gs, move)) return;
+  }
+  for (size_t c = drag.start; c < drag.start + drag.count; ++c) {
+    ResetPosition(&drag.deck->items[c]);
+  }
+}
+
+// Sets up the next deck of the row. Its cards are filled in by SyncDeck.
+void AddDeck(DeckFiles *decks, DeckKind kind, size_t pile, Vector2 position, float height) {
+  Deck *d = &decks->items[decks->count++];
+  d->count = 0;
+  d->kind = kind;
+  d->pile = pile;
+  d->position = position;
+  d->bounds = CLITERAL(Rectangle) { .x = position.x, .y = position.y, .width = PILES_WIDTH, .height = height };
+}
+
+// Lays the table out for the variant on a grid of one column per file: the free cells take the
+// first columns of the top row and the foundations the last ones, next to the stock and waste.
+void LayoutTable(GameState *gs, const Variant *variant) {
+  gs->files.count = 0;
+  gs->foundations.count = 0;
+  gs->cells.count = 0;
+
+  size_t columns = variant->tableau;
+  size_t total_x = (columns*PILES_WIDTH)+((columns-1)*PILES_SPACING);
+  size_t fx = (GetScreenWidth() - total_x) / 2;
+  size_t fy = 20 + PILES_HEIGHT + 50;
+  for (size_t f = 0; f < columns; ++f) {
+    Vector2 pos = { .x = fx + (PILES_WIDTH * f) + (PILES_SPACING * f), .y = fy };
+    AddDeck(&gs->files, DECK_FILE, PILE_TABLEAU + f, pos, GetScreenHeight()-fy);
+  }
+  for (size_t f = 0; f < variant->foundations; ++f) {
+    size_t column = columns - variant->foundations + f;
+    Vector2 pos = { .x = fx + (PILES_WIDTH * column) + (PILES_SPACING * column), .y = 20 };
+    AddDeck(&gs->foundations, DECK_FOUNDATION, PILE_FOUNDATION + f, pos, PILES_HEIGHT);
+  }
+  for (size_t c = 0; c < variant->cells; ++c) {
+    Vector2 pos = { .x = fx + (PILES_WIDTH * c) + (PILES_SPACING * c), .y = 20 };
+    AddDeck(&gs->cells, DECK_CELL, PILE_CELL + c, pos, PILES_HEIGHT);
+  }
+}
+
+// Puts the stock and the waste at the top left of the table, the stock drawn with `back`.
+void SetUpTalon(GameState *gs, Back *back) {
+  gs->deck.kind = DECK_STD;
+  gs->deck.pile = PILE_STOCK;
+  gs->drawn.kind = DECK_DISCARD;
+  gs->drawn.pile = PILE_WASTE;
+  gs->drawn.bounds = CLITERAL(Rectangle) { .x = 10, .y = 20, .width = PILES_WIDTH, .height = PILES_HEIGHT };
+  gs->activeBack = back;
+  back->bounds.x = gs->drawn.bounds.x + (gs->drawn.bounds.width-(CARD_WIDTH))/2;
+  back->bounds.y = gs->drawn.bounds.y + (gs->drawn.bounds.height-(CARD_HEIGHT))/2;
+}
+
+// Sets the table up for the board just dealt. Every card starts on the stock so the deal glides
+// out of it.
+void ShowDeal(GameState *gs) {
+  LayoutTable(gs, BoardVariant(&gs->board));
+  for (size_t c = 0; c < CARD_ID_LIMIT; ++c) {
+    gs->cardPositions[c] = CLITERAL(Vector2) { .x = gs->activeBack->bounds.x, .y = gs->activeBack->bounds.y };
+  }
+  gs->replay.count = 0;
+  gs->replay.next = 0;
+  gs->hintPending = false;
+  gs->hintShown = false;
+  SyncDecks(gs);
+}
+
+SaveHeader GameHeader(GameState *gs) {
+  SaveHeader header = { .variant = gs->board.variant, .drawCount = gs->board.drawCount, .cardCount = gs->cardCount };
+  memcpy(header.order, gs->order, gs->cardCount);
+  return header;
+}
+
+// Starts playing `board`, dealt from `order`, and saving the game over. A game left after moves
+// were made counts as lost.
+void StartGame(GameState *gs, const Board *board, const CardId *order, size_t count) {
+  if (!gs->finished && gs->journal.count > 0) CountGame(gs->stats, false);
+  gs->finished = false;
+  gs->verdict = SOLVE_UNKNOWN;
+  gs->board = *board;
+  memcpy(gs->order, order, count);
+  gs->cardCount = count;
+  gs->journal.count = 0;
+  CloseSave(&gs->save);
+  gs->savePending = true;
+  ShowDeal(gs);
+}
+
+// Starts the save of a game dealt on an earlier frame, with whatever moves it has by now. A game
+// that cannot be saved is still played.
+void StartPendingSave(GameState *gs) {
+  if (!gs->savePending) return;
+  gs->savePending = false;
+  BeginSave(&gs->save, SAVE_PATH, GameHeader(gs), &gs->journal);
+}
+
+bool NewGame(GameState *gs, VariantKind variant, size_t drawCount, const CardId *order, size_t count) {
+  Board board;
+  if (!DealBoard(&board, variant, order, count, drawCount)) return false;
+  StartGame(gs, &board, order, count);
+  return true;
+}
+
+// Takes the deal the prefetcher has ready, so nothing is shuffled or dealt on the frame. Only a
+// deal of another variant, or one asked for before the worker is done, is made here.
+bool NewRandomGame(GameState *gs, VariantKind variant, size_t drawCount) {
+  static PreparedDeal deal;
+  if (TakePreparedDeal(gs->prefetcher, variant, drawCount, &deal)) {
+    StartGame(gs, &deal.board, deal.order, deal.count);
+    gs->verdict = deal.verdict;
+  } else {
+    CardId order[MAX_CARDS];
+    size_t count = FillShoe(order, variants[variant].decks);
+    ShuffleCardIds(order, count, &gs->random);
+    if (!NewGame(gs, variant, drawCount, order, count)) return false;
+  }
+  // Variants without a stock to draw from always deal with a draw count of 1.
+  PrefetchDeal(gs->prefetcher, gs->board.variant, gs->board.drawCount);
+  return true;
+}
+
+// Deals deal `number` of the deal file, with the variant and draw count the file was made for.
+bool NewDealtGame(GameState *gs, const char *path, size_t number) {
+  DealDb db;
+  if (!OpenDealDb(&db, path)) return false;
+  const CardId *order;
+  const DealInfo *info = DealAt(&db, number, &order);
+  bool ok = info != NULL;
+  if (!ok) nob_log(NOB_ERROR, "%s has no deal %zu, only %zu", path, number, db.count);
+  ok = ok && NewGame(gs, db.header->variant, db.header->drawCount, order, db.header->cardCount);
+  CloseDealDb(&db);
+  return ok;
+}
+
+// Picks the saved game back up by playing its journal on the same deal. A move that is no longer
+// legal ends the journal there. False when there is no game to resume, including a finished one.
+bool ResumeGame(GameState *gs) {
+  // The saved game went into the stats when it was won, so one that cannot go on is not counted.
+  gs->finished = true;
+  SaveHeader header;
+  if (!LoadSave(SAVE_PATH, &header, &gs->journal)) return false;
+  if (header.cardCount > MAX_CARDS) return false;
+  if (!DealBoard(&gs->board, header.variant, header.order, header.cardCount, header.drawCount)) return false;
+  size_t played = 0;
+  while (played < gs->journal.count && IsMoveLegal(&gs->board, gs->journal.items[played])) {
+    PlayMove(gs, gs->journal.items[played++]);
+  }
+  gs->journal.count = played;
+  if (IsBoardWon(&gs->board) || gs->replay.count > 0) return false;
+  memcpy(gs->order, header.order, header.cardCount);
+  gs->cardCount = header.cardCount;
+  // Writing the file over drops whatever did not play back.
+  BeginSave(&gs->save, SAVE_PATH, GameHeader(gs), &gs->journal);
+  ShowDeal(gs);
+  gs->finished = false;
+  gs->verdict = SOLVE_UNKNOWN;
+  return true;
+}
+
+// Multi-table mode shows many games at once, each played by a bot on its own board. Every table is
+// laid out by LayoutTable and DeckCardPosition exactly like the game's own and scaled down from the
+// screen into a cell of the grid, and all of them are drawn in two passes, every back first and
+// then every face, so the whole grid costs two texture switches however many tables there are.
+#define TABLE_MAX 64
+#define TABLE_BOT_STEP 0.1f
+// A bot that has not won after this many moves is going round in circles; its table is dealt again.
+#define TABLE_MAX_MOVES 600
+
+typedef struct {
+  Board board;
+  uint64_t random;
+  float timer;
+  size_t moves;
+} Table;
+
+typedef struct {
+  Table items[TABLE_MAX];
+  size_t count;
+  size_t won;
+  // The decks of a table of the variant being played, laid out as on the game's own screen.
+  GameState layout;
+} Tables;
+
+void DealTable(Table *table, VariantKind variant, size_t drawCount) {
+  DealSeed(&table->board, variant, NextRandom(&table->random), drawCount);
+  table->moves = 0;
+}
+
+// Deals `count` tables of the variant, each with a bot of its own, or turns the mode off for 0.
+void StartTables(Tables *tables, Back *back, size_t count, VariantKind variant, size_t drawCount) {
+  tables->count = count;
+  tables->won = 0;
+  SetUpTalon(&tables->layout, back);
+  LayoutTable(&tables->layout, &variants[variant]);
+  for (size_t t = 0; t < count; ++t) {
+    Table *table = &tables->items[t];
+    table->random = 0x7AB1E + t;
+    // Spread the bots out so the tables do not all move on the same frame.
+    table->timer = TABLE_BOT_STEP*t/count;
+    DealTable(table, variant, drawCount);
+  }
+}
+
+// The bot puts up whatever it can and otherwise plays a random legal move.
+void StepTableBot(Tables *tables, Table *table) {
+  Board *board = &table->board;
+  Move moves[MAX_MOVES];
+  size_t n = GenerateMoves(board, moves);
+  if (n == 0 || table->moves >= TABLE_MAX_MOVES || IsBoardWon(board)) {
+    if (IsBoardWon(board)) tables->won++;
+    DealTable(table, board->variant, board->drawCount);
+    return;
+  }
+  Move move = moves[NextRandom(&table->random) % n];
+  for (size_t m = 0; m < n; ++m) {
+    if (moves[m].kind == MOVE_TRANSFER && IsFoundation(moves[m].to)) move = moves[m];
+  }
+  ApplyMove(board, move);
+  Move run;
+  while (FindCompletedRun(board, &run)) ApplyMove(board, run);
+  if (CanAutoComplete(board)) {
+    Move rest[AUTO_COMPLETE_MAX_MOVES];
+    AutoComplete(board, rest);
+  }
+  table->moves++;
+}
+
+void UpdateTables(Tables *tables, float dt) {
+  for (size_t t = 0; t < tables->count; ++t) {
+    Table *table = &tables->items[t];
+    table->timer += dt;
+    while (table->timer >= TABLE_BOT_STEP) {
+      table->timer -= TABLE_BOT_STEP;
+      StepTableBot(tables, table);
+    }
+  }
+}
+
+Rectangle ToCell(Rectangle r, Vector2 offset, float scale) {
+  return CLITERAL(Rectangle) { .x = offset.x + r.x*scale, .y = offset.y + r.y*scale, .width = r.width*scale, .height = r.height*scale };
+}
+
+// One pass over every table: the backs when `faces` is false, the face-up cards when it is true.
+// Only the top cards of the talon, the cells and the foundations can be seen, so only those are
+// drawn.
+void DrawTablesPass(Tables *tables, Texture2D texture, bool faces, Vector2 mouse) {
+  GameState *layout = &tables->layout;
+  size_t columns = 1;
+  while (columns*columns < tables->count) columns++;
+  size_t rows = (tables->count + columns - 1)/columns;
+  float cellWidth = (float)GetScreenWidth()/columns;
+  float cellHeight = (float)GetScreenHeight()/rows;
+  float scale = cellWidth/GetScreenWidth() < cellHeight/GetScreenHeight() ? cellWidth/GetScreenWidth() : cellHeight/GetScreenHeight();
+  scale *= 0.95f;
+  Deck *decks[2 + 3*DECK_ROW_MAX];
+  size_t deckCount = 0;
+  decks[deckCount++] = &layout->deck;
+  decks[deckCount++] = &layout->drawn;
+  for (size_t f = 0; f < layout->foundations.count; ++f) decks[deckCount++] = &layout->foundations.items[f];
+  for (size_t c = 0; c < layout->cells.count; ++c) decks[deckCount++] = &layout->cells.items[c];
+  for (size_t f = 0; f < layout->files.count; ++f) decks[deckCount++] = &layout->files.items[f];
+  for (size_t t = 0; t < tables->count; ++t) {
+    const Board *board = &tables->items[t].board;
+    layout->board.drawCount = board->drawCount;
+    Vector2 offset = {
+      .x = (t % columns)*cellWidth + (cellWidth - GetScreenWidth()*scale)/2,
+      .y = (t / columns)*cellHeight + (cellHeight - GetScreenHeight()*scale)/2,
+    };
+    for (size_t d = 0; d < deckCount; ++d) {
+      Deck *deck = decks[d];
+      PileView view = ViewPile(board, deck->pile);
+      size_t first = view.count;
+      if (deck->kind == DECK_FILE) first = 0;
+      else if (deck->kind == DECK_DISCARD) first = view.count - (view.count < board->drawCount ? view.count : board->drawCount);
+      else if (view.count > 0) first = view.count - 1;
+      for (size_t c = first; c < view.count; ++c) {
+        Card card = PileCard(layout, board, deck, view, c);
+        if (card.flipped != faces) continue;
+        DrawDeckItemToScreen(texture, ToCell(card.bounds, offset, scale), faces ? card.source : layout->activeBack->source, mouse);
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv) {
   InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Cards");
 
   Image cardsImg = LoadImage("./assets/cards.png");
   Texture cardsTexture = LoadTextureFromImage(cardsImg);
   UnloadImage(cardsImg);
   
-  Deck deck = {0};
-  deck.kind = DECK_STD;
-  if (!CreateSTDDeck(&deck)) return 1;
-  ShuffleDeck(&deck);
-  Deck drawn = {0};
-  drawn.kind = DECK_DISCARD;
-  drawn.bounds = CLITERAL(Rectangle) { .x = 10, .y = 20, .width = PILES_WIDTH, .height = PILES_HEIGHT }; 
   Image backsImg = LoadImage("./assets/backs.png");
   Texture backsTexture = LoadTextureFromImage(backsImg);
   UnloadImage(backsImg);
   Backs *backs = {0};
   CreateBacks(&backs, BK_MEANDER_BORDER);
 
-  DeckFiles deckFiles = {0};
+  // Counting never blocks; a stats file that cannot be written only loses the stats.
+  static Stats stats;
+  StartStats(&stats, STATS_PATH);
+  static Hinter hinter;
+  if (!StartHinter(&hinter, &stats.process.solverNodes)) return 1;
+  static Estimator estimator;
+  if (!StartEstimator(&estimator, &stats.process.solverNodes)) return 1;
+  static Tables tables;
+  // L shows frame pacing and how far a dragged card trails the pointer.
+  static Pacing pacing;
+  bool pacingShown = false;
+  // P draws dragged cards ahead, where the pointer is expected to be when the frame shows.
+  bool predictDrag = false;
+  int refreshRate = GetMonitorRefreshRate(GetCurrentMonitor());
+  StartPacing(&pacing, refreshRate > 0 ? 1.0/refreshRate : 0);
 
-  GameState gs = {0};
-  gs.deck = deck;
-  gs.drawn = drawn;
+  static GameState gs;
+  SetUpTalon(&gs, &hmget(backs, BC_BLUE));
   gs.backs = backs;
   gs.activeCard = NULL;
   gs.hoveredCard = NULL;
-  gs.activeBack = &hmget(backs, BC_BLUE);
-  gs.files = deckFiles;
   gs.hoveredFile = NULL;
-  gs.homeFile = NULL;
-  
-  gs.activeBack->bounds.x = gs.drawn.bounds.x + (gs.drawn.bounds.width-(CARD_WIDTH))/2;
-  gs.activeBack->bounds.y = gs.drawn.bounds.y + (gs.drawn.bounds.height-(CARD_HEIGHT))/2;
 
-  size_t total_x = (FILES_COUNT*PILES_WIDTH)+((FILES_COUNT-1)*PILES_SPACING);
+  gs.save.fd = -1;
+  gs.stats = &stats;
+  gs.random = (uint64_t)time(NULL);
+  static Prefetcher prefetcher;
+  if (!StartPrefetcher(&prefetcher, NextRandom(&gs.random), &stats.process.solverNodes)) return 1;
+  gs.prefetcher = &prefetcher;
+  gs.verdict = SOLVE_UNKNOWN;
 
-  size_t fx = (GetScreenWidth() - total_x) / 2;
-  size_t fy = 20 + PILES_HEIGHT + 50;
-  for (size_t f = 0; f < FILES_COUNT; ++f) {
-    Deck d = {0};
-    d.kind = DECK_FILE;
-    d.position = CLITERAL(Vector2) { .x = fx + (PILES_WIDTH * f) + (PILES_SPACING * f), .y = fy };
-    d.bounds = CLITERAL(Rectangle) { .x = d.position.x, .y = d.position.y, .width = PILES_WIDTH, .height = GetScreenHeight()-fy }; 
-    for (size_t c = 0; c < f+1; ++c) {
-      Card *card = GetNextCard(&gs.deck, &d);
-      if (c == f)
-        card->flipped = true;
-      card->bounds.x = d.position.x + (PILES_WIDTH-CARD_WIDTH)/2; 
-      card->bounds.y = (d.position.y + (PILES_HEIGHT-CARD_HEIGHT)/2) + (PILES_SPACING * 2) * c;
-    }
-    nob_da_append(&gs.files, d);
+  // `main <deal file> <deal number>` plays a curated deal; otherwise the saved game goes on.
+  if (argc == 3) {
+    if (!NewDealtGame(&gs, argv[1], strtoull(argv[2], NULL, 10))) return 1;
+  } else if (!ResumeGame(&gs) && !NewRandomGame(&gs, VARIANT_KLONDIKE, 1)) {
+    return 1;
   }
+  gs.drawChoice = gs.board.drawCount;
+  PrefetchDeal(&prefetcher, gs.board.variant, gs.board.drawCount);
 
   while(!WindowShouldClose()) {
+    StartPendingSave(&gs);
     BeginDrawing();
     ClearBackground(DARKGRAY);
 
@@ -328,102 +845,195 @@ int main(void) {
 
     Vector2 mouse = GetMousePosition();
     Vector2 delta = GetMouseDelta();
+    PacingFrame(&pacing, GetTime(), mouse.x, mouse.y);
+    bool replaying = IsReplaying(&gs);
+
+    CountStat(&stats.process.frames, 1);
+    if (!gs.finished && tables.count == 0) CountStat(&stats.player.microseconds, GetFrameTime()*1e6);
+    UpdateReplay(&gs, GetFrameTime());
+    GlideDecks(&gs, GetFrameTime());
+
+    // T steps multi-table mode through 16, 36 and 64 tables of the current variant and back off.
+    if (IsKeyPressed(KEY_T) && !gs.activeCard) {
+      size_t count = tables.count == 0 ? 16 : tables.count == 16 ? 36 : tables.count == 36 ? TABLE_MAX : 0;
+      StartTables(&tables, gs.activeBack, count, gs.board.variant, gs.board.drawCount);
+    }
+    if (tables.count > 0) {
+      UpdateTables(&tables, GetFrameTime());
+      DrawTablesPass(&tables, backsTexture, false, mouse);
+      DrawTablesPass(&tables, cardsTexture, true, mouse);
+      DrawText(TextFormat("%zu tables, %zu won, %d FPS", tables.count, tables.won, GetFPS()), 10, GetScreenHeight()-40, 30, LIME);
+      EndDrawing();
+      continue;
+    }
+
+    if (IsKeyPressed(KEY_H) && !replaying && !gs.activeCard) {
+      RequestHint(&hinter, &gs.board);
+      gs.hintPending = true;
+      gs.hintShown = false;
+    }
+    if (gs.hintPending && PollHint(&hinter, &gs.hintShown, &gs.hint)) gs.hintPending = false;
+
+    // N deals a new game, V the next variant; D switches Klondike between drawing one and three
+    // cards.
+    const Variant *variant = BoardVariant(&gs.board);
+    if (IsKeyPressed(KEY_N) && !gs.activeCard) {
+      if (!NewRandomGame(&gs, gs.board.variant, gs.board.drawCount)) return 1;
+      replaying = false;
+    }
+    if (IsKeyPressed(KEY_V) && !gs.activeCard) {
+      VariantKind next = (gs.board.variant + 1) % VARIANT_COUNT;
+      if (!NewRandomGame(&gs, next, variants[next].stock == STOCK_DRAW ? gs.drawChoice : 1)) return 1;
+      variant = BoardVariant(&gs.board);
+      replaying = false;
+    }
+    if (IsKeyPressed(KEY_D) && !gs.activeCard && variant->stock == STOCK_DRAW) {
+      gs.drawChoice = gs.board.drawCount == 1 ? 3 : 1;
+      if (!NewRandomGame(&gs, gs.board.variant, gs.drawChoice)) return 1;
+      replaying = false;
+    }
 
     if (gs.activeCard) {
       gs.hoveredCard = gs.activeCard;
-      UpdatePosition(gs.activeCard, delta);
+      DragCards(&gs, delta, GetFrameTime(), predictDrag);
     }
 
     for (size_t f = 0; f < gs.files.count; ++f) {
-      Deck d = gs.files.items[f];
-      if (CheckCollisionPointRec(mouse, d.bounds)) {
-        DrawRectangleRec(d.bounds, BLUE);
-        gs.hoveredFile = &gs.files.items[f];
+      Deck *d = &gs.files.items[f];
+      if (CheckCollisionPointRec(mouse, d->bounds)) {
+        DrawRectangleRec(d->bounds, BLUE);
+        gs.hoveredFile = d;
+      }
+    }
+    for (size_t f = 0; f < gs.foundations.count; ++f) {
+      Deck *d = &gs.foundations.items[f];
+      if (CheckCollisionPointRec(mouse, d->bounds)) {
+        DrawRectangleRec(d->bounds, BLUE);
+        gs.hoveredFile = d;
+      }
+    }
+    for (size_t c = 0; c < gs.cells.count; ++c) {
+      Deck *d = &gs.cells.items[c];
+      if (CheckCollisionPointRec(mouse, d->bounds)) {
+        DrawRectangleRec(d->bounds, BLUE);
+        gs.hoveredFile = d;
       }
     }
 
-    DrawRectangleLinesEx(gs.drawn.bounds, 5, DARKPURPLE);
-    
-    if (gs.deck.count > 0) {
-      DrawDeckItemToScreen(backsTexture, gs.activeBack->bounds, gs.activeBack->source, mouse);
+    if (variant->stock != STOCK_NONE) {
+      DrawRectangleLinesEx(gs.drawn.bounds, 5, DARKPURPLE);
 
-      if (CheckCollisionPointRec(mouse, gs.drawn.bounds) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-        Card *card = GetNextCard(&gs.deck, &gs.drawn); 
-        card->bounds.x = gs.drawn.bounds.x + gs.drawn.bounds.width + 25;
-        card->bounds.y = gs.activeBack->bounds.y;
-        card->flipped = true;
-      }
-    } else {
-      if (CheckCollisionPointRec(mouse, gs.drawn.bounds) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT) & !gs.activeCard) {
-        for (size_t c = 0; c < gs.drawn.count; ++c) {
-          Card card = gs.drawn.items[c];
-          card.drawn = false;
-          card.flipped = false;
-          nob_da_append(&gs.deck, card);
+      bool clicked = CheckCollisionPointRec(mouse, gs.drawn.bounds) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && !gs.activeCard && !replaying;
+      if (gs.deck.count > 0) {
+        DrawDeckItemToScreen(backsTexture, gs.activeBack->bounds, gs.activeBack->source, mouse);
+        if (clicked && variant->stock == STOCK_DEAL) {
+          TryMove(&gs, CLITERAL(Move) { .kind = MOVE_DEAL, .from = PILE_STOCK, .to = PILE_TABLEAU, .count = variant->tableau });
+        } else if (clicked) {
+          TryMove(&gs, CLITERAL(Move) { .kind = MOVE_DRAW, .from = PILE_STOCK, .to = PILE_WASTE, .count = gs.board.drawCount });
         }
-        gs.drawn.count = 0;
+      } else if (clicked) {
+        TryMove(&gs, CLITERAL(Move) { .kind = MOVE_RECYCLE, .from = PILE_WASTE, .to = PILE_STOCK, .count = gs.drawn.count });
       }
+
+      const char* text = sizetToString(gs.deck.count, 2);
+      DrawText(text, gs.drawn.bounds.x, gs.drawn.bounds.y+gs.drawn.bounds.height+10, 30, LIME);
     }
+    const char *verdict = gs.verdict == SOLVE_WON ? ", winnable" : gs.verdict == SOLVE_LOST ? ", no way to win" : "";
+    DrawText(TextFormat("%s%s", variant->name, verdict), 10, GetScreenHeight()-40, 30, LIME);
 
-    const char* text = sizetToString(gs.deck.count, 2);
-    DrawText(text, gs.drawn.bounds.x, gs.drawn.bounds.y+gs.drawn.bounds.height+10, 30, LIME);
+    if (IsKeyPressed(KEY_W) && !gs.activeCard) {
+      gs.estimating = !gs.estimating;
+      if (gs.estimating) {
+        gs.estimated = gs.board;
+        EstimatePosition(&estimator, &gs.board);
+      } else {
+        PauseEstimator(&estimator);
+      }
+    }
+    if (gs.estimating) {
+      if (!BoardsEqual(&gs.board, &gs.estimated)) {
+        gs.estimated = gs.board;
+        EstimatePosition(&estimator, &gs.board);
+      }
+      Estimate estimate = ReadEstimate(&estimator);
+      double chance = estimate.playouts > 0 ? 100.0*estimate.wins/estimate.playouts : 0;
+      const char *text = TextFormat("Win %.0f%% of %zu playouts, %.0f/s", chance, estimate.playouts, estimate.playoutsPerSecond);
+      DrawText(text, 10, GetScreenHeight()-80, 30, LIME);
+    }
 
     for (size_t c = 0; c < gs.drawn.count; ++c) {
-      Card card = gs.drawn.items[c];
-      if (DrawDeckItemToScreen(cardsTexture, card.bounds, card.source, mouse) && !gs.activeCard) 
-        gs.hoveredCard = &gs.drawn.items[c];
+      Card *card = &gs.drawn.items[c];
+      if (DrawDeckItemToScreen(cardsTexture, card->bounds, card->source, mouse) && !gs.activeCard && c == gs.drawn.count-1)
+        gs.hoveredCard = card;
+    }
+
+    for (size_t f = 0; f < gs.foundations.count; ++f) {
+      Deck *d = &gs.foundations.items[f];
+      DrawRectangleLinesEx(d->bounds, 5, DARKPURPLE);
+      for (size_t c = 0; c < d->count; ++c) {
+        Card *card = &d->items[c];
+        if (DrawDeckItemToScreen(cardsTexture, card->bounds, card->source, mouse) && !gs.activeCard && c == d->count-1)
+          gs.hoveredCard = card;
+      }
+    }
+    for (size_t f = 0; f < gs.cells.count; ++f) {
+      Deck *d = &gs.cells.items[f];
+      DrawRectangleLinesEx(d->bounds, 5, DARKPURPLE);
+      for (size_t c = 0; c < d->count; ++c) {
+        Card *card = &d->items[c];
+        if (DrawDeckItemToScreen(cardsTexture, card->bounds, card->source, mouse) && !gs.activeCard)
+          gs.hoveredCard = card;
+      }
     }
 
     for (size_t f = 0; f < gs.files.count; ++f) {
-      Deck d = gs.files.items[f];
-      Rectangle r = { .x = d.position.x, .y = d.position.y, .width = PILES_WIDTH, .height = PILES_HEIGHT };
+      Deck *d = &gs.files.items[f];
+      Rectangle r = { .x = d->position.x, .y = d->position.y, .width = PILES_WIDTH, .height = PILES_HEIGHT };
       DrawRectangleLinesEx(r, 5, DARKPURPLE);
-      for (size_t c = 0; c < d.count; ++c) {
-        Card card = d.items[c];
-        if (card.flipped) {
-          if (DrawDeckItemToScreen(cardsTexture, card.bounds, card.source, mouse) && !gs.activeCard)
-            gs.hoveredCard = &d.items[c];
+      for (size_t c = 0; c < d->count; ++c) {
+        Card *card = &d->items[c];
+        // The dragged run is drawn last, on top of everything.
+        if (IsDragged(&gs, card)) continue;
+        if (card->flipped) {
+          if (DrawDeckItemToScreen(cardsTexture, card->bounds, card->source, mouse) && !gs.activeCard)
+            gs.hoveredCard = card;
         } else {
-          DrawDeckItemToScreen(backsTexture, card.bounds, gs.activeBack->source, mouse);
+          DrawDeckItemToScreen(backsTexture, card->bounds, gs.activeBack->source, mouse);
         }
       }
     }
 
+    if (gs.hintShown) DrawHint(&gs);
+
+    if (IsKeyPressed(KEY_P)) predictDrag = !predictDrag;
+    if (IsKeyPressed(KEY_L)) {
+      pacingShown = !pacingShown;
+      if (pacingShown) StartPacing(&pacing, pacing.refresh);
+    }
+    if (pacingShown) {
+      const PacingReport *report = ShownPacing(&pacing, GetTime());
+      DrawText(TextFormat("Frame %.2f ms, p99 %.2f ms, jitter %.2f ms", report->frameMean*1e3, report->frameP99*1e3, report->jitter*1e3),
+               10, GetScreenHeight()-160, 30, LIME);
+      DrawText(TextFormat("Drag%s: input to photon (est.) %.1f/%.1f ms, lag %.0f/%.0f px, %.1f ms (p50/p99)", predictDrag ? " predicted" : "",
+                          report->latencyP50*1e3, report->latencyP99*1e3, report->lagPixelsP50, report->lagPixelsP99, report->lagSecondsP50*1e3),
+               10, GetScreenHeight()-120, 30, LIME);
+    }
+
     if (gs.hoveredCard) {
       DrawHoveredOutline(gs.hoveredCard->bounds);
       if (!gs.activeCard) {
-        if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
-          gs.activeCard = gs.hoveredCard;
-          if (gs.hoveredFile)
-            gs.homeFile = gs.hoveredFile;
-          if (CheckCollisionPointRec(mouse, gs.hoveredCard->bounds))
-            gs.homeFile = &gs.drawn;
-        }
+        if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && !replaying) StartDrag(&gs, gs.hoveredCard, mouse);
       } else {
         if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
-          if (gs.hoveredFile) {
-            if (gs.hoveredFile->count == 0) {
-              SetPosition(gs.activeCard, gs.hoveredFile->cardStart);
-            } else {
-              Card last = gs.hoveredFile->items[gs.hoveredFile->count-1];
-              Vector2 pos = { .x = last.bounds.x, .y = last.bounds.y };
-              pos.y += (PILES_SPACING*2);
-              RemoveCardFromDeck(gs.activeCard, gs.homeFile);
-              nob_log(NOB_INFO, "%ld", gs.homeFile->count);
-              //nob_log(NOB_INFO, "%d, %d", gs.homeFile->items[gs.homeFile->count-1].suit, gs.homeFile->items[gs.homeFile->count-1].value);
-              if (gs.homeFile->count > 0 && !gs.homeFile->items[gs.homeFile->count-1].flipped) {
-                gs.homeFile->items[gs.homeFile->count-1].flipped = true;
-              }
-              SetPosition(gs.activeCard, pos);
-              AddCardToDeck(gs.activeCard, gs.hoveredFile);
-            }
-          } else {
-            ResetPosition(gs.activeCard);
-          }
-          gs.activeCard = NULL;
-          gs.homeFile = NULL;
+          EndDrag(&gs, gs.hoveredFile);
         } else {
-          DrawDeckItemToScreen(cardsTexture, gs.activeCard->bounds, gs.activeCard->source, mouse);
+          Vector2 lead = gs.drag.lead;
+          for (size_t c = gs.drag.start; c < gs.drag.start + gs.drag.count; ++c) {
+            Card *card = &gs.drag.deck->items[c];
+            Rectangle bounds = { .x = card->bounds.x + lead.x, .y = card->bounds.y + lead.y, .width = card->bounds.width, .height = card->bounds.height };
+            DrawDeckItemToScreen(cardsTexture, bounds, card->source, mouse);
+          }
+          PacingDragDrawn(&pacing, gs.activeCard->bounds.x + gs.drag.grab.x + lead.x, gs.activeCard->bounds.y + gs.drag.grab.y + lead.y);
         }
       }
     }
@@ -431,6 +1041,21 @@ int main(void) {
     EndDrawing();
   }
 
+  if (pacingShown) {
+    PacingReport report = ReadPacing(&pacing);
+    printf("pacing: %zu frames, %.2f ms mean, p99 %.2f ms, jitter %.2f ms\n",
+           report.frames, report.frameMean*1e3, report.frameP99*1e3, report.jitter*1e3);
+    printf("pacing: %zu drag frames%s, estimated input to photon p50 %.1f ms p99 %.1f ms, lag p50 %.0f px p99 %.0f px, %.1f ms\n",
+           report.drags, predictDrag ? " predicted" : "", report.latencyP50*1e3, report.latencyP99*1e3, report.lagPixelsP50, report.lagPixelsP99, report.lagSecondsP50*1e3);
+  }
+
+  StopHinter(&hinter);
+  StopEstimator(&estimator);
+  StopPrefetcher(&prefetcher);
+  StopStats(&stats);
+  StartPendingSave(&gs);
+  CloseSave(&gs.save);
+  nob_da_free(gs.journal);
   UnloadTexture(cardsTexture);
   UnloadTexture(backsTexture);
 
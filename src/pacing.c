@@ -0,0 +1,93 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pacing.h"
+
+static void Record(PacingRing *ring, double value) {
+  ring->values[ring->next] = value;
+  ring->next = (ring->next + 1) % PACING_SAMPLES;
+  if (ring->count < PACING_SAMPLES) ring->count++;
+}
+
+static int CompareDoubles(const void *a, const void *b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+// Percentiles of the samples in the ring, sorted into `sorted`.
+static double Percentile(const PacingRing *ring, double *sorted, double fraction) {
+  if (ring->count == 0) return 0;
+  memcpy(sorted, ring->values, ring->count*sizeof(*sorted));
+  qsort(sorted, ring->count, sizeof(*sorted), CompareDoubles);
+  size_t index = fraction*ring->count;
+  return sorted[index < ring->count ? index : ring->count - 1];
+}
+
+void StartPacing(Pacing *pacing, double refresh) {
+  memset(pacing, 0, sizeof(*pacing));
+  pacing->refresh = refresh;
+}
+
+void PacingFrame(Pacing *pacing, double now, float pointerX, float pointerY) {
+  if (pacing->lastFrameAt > 0) {
+    double interval = now - pacing->lastFrameAt;
+    Record(&pacing->intervals, interval);
+    if (pacing->dragDrawn) {
+      Record(&pacing->latencies, pacing->lastInterval/2 + interval + pacing->refresh);
+      float dx = pointerX - pacing->drawnX;
+      float dy = pointerY - pacing->drawnY;
+      double lag = sqrtf(dx*dx + dy*dy);
+      Record(&pacing->lagPixels, lag);
+      // The pointer's speed over the frame; a pointer that did not move shows no lag in time.
+      float mx = pointerX - pacing->pointerX;
+      float my = pointerY - pacing->pointerY;
+      double speed = sqrtf(mx*mx + my*my)/interval;
+      if (speed > 0) Record(&pacing->lagSeconds, lag/speed);
+    }
+    pacing->lastInterval = interval;
+  }
+  pacing->lastFrameAt = now;
+  pacing->pointerX = pointerX;
+  pacing->pointerY = pointerY;
+  pacing->dragDrawn = false;
+}
+
+void PacingDragDrawn(Pacing *pacing, float x, float y) {
+  pacing->dragDrawn = true;
+  pacing->drawnX = x;
+  pacing->drawnY = y;
+}
+
+PacingReport ReadPacing(const Pacing *pacing) {
+  static double sorted[PACING_SAMPLES];
+  PacingReport report = { .frames = pacing->intervals.count, .drags = pacing->latencies.count };
+  const PacingRing *intervals = &pacing->intervals;
+  if (intervals->count > 0) {
+    double sum = 0;
+    for (size_t i = 0; i < intervals->count; ++i) sum += intervals->values[i];
+    report.frameMean = sum/intervals->count;
+    double squares = 0;
+    for (size_t i = 0; i < intervals->count; ++i) {
+      double d = intervals->values[i] - report.frameMean;
+      squares += d*d;
+    }
+    report.jitter = sqrt(squares/intervals->count);
+    report.frameP99 = Percentile(intervals, sorted, 0.99);
+  }
+  report.latencyP50 = Percentile(&pacing->latencies, sorted, 0.5);
+  report.latencyP99 = Percentile(&pacing->latencies, sorted, 0.99);
+  report.lagPixelsP50 = Percentile(&pacing->lagPixels, sorted, 0.5);
+  report.lagPixelsP99 = Percentile(&pacing->lagPixels, sorted, 0.99);
+  report.lagSecondsP50 = Percentile(&pacing->lagSeconds, sorted, 0.5);
+  return report;
+}
+
+const PacingReport *ShownPacing(Pacing *pacing, double now) {
+  if (pacing->shownAt == 0 || now - pacing->shownAt >= PACING_REPORT_SECONDS) {
+    pacing->shown = ReadPacing(pacing);
+    pacing->shownAt = now;
+  }
+  return &pacing->shown;
+}
@@ -0,0 +1,73 @@
+#ifndef PACING_H_
+#define PACING_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Measures frame pacing and how far a dragged card trails the pointer, for tuning drag latency.
+// raylib polls input right after it presents a frame, so the start of a frame marks both the
+// present of the one before and the moment its input was read. From that:
+//
+//   input to photon  an estimate, not a measurement: an input waits half a frame on average to be
+//                    polled, is drawn in the next frame and presented at its end, then scanned out
+//                    over one refresh
+//   drag lag         the distance from where the grabbed point of the card was drawn to where the
+//                    pointer really was when that frame was presented, read off the next poll;
+//                    divided by the pointer's speed it is the lag seen as time
+//
+// Only timestamps and positions go in, so the frame loop pays a few stores per frame. The
+// percentiles take sorting the rings, so the overlay works them out a few times a second only.
+
+#define PACING_SAMPLES 600
+#define PACING_REPORT_SECONDS 0.25
+
+typedef struct {
+  double values[PACING_SAMPLES];
+  size_t count;
+  size_t next;
+} PacingRing;
+
+typedef struct {
+  size_t frames;
+  double frameMean;
+  double frameP99;
+  // Standard deviation of the frame intervals.
+  double jitter;
+  size_t drags;
+  double latencyP50;
+  double latencyP99;
+  double lagPixelsP50;
+  double lagPixelsP99;
+  double lagSecondsP50;
+} PacingReport;
+
+typedef struct {
+  double refresh;
+  double lastFrameAt;
+  double lastInterval;
+  PacingRing intervals;
+  PacingRing latencies;
+  PacingRing lagPixels;
+  PacingRing lagSeconds;
+  // The grabbed point as drawn in the last frame, when a card was being dragged.
+  bool dragDrawn;
+  float drawnX;
+  float drawnY;
+  float pointerX;
+  float pointerY;
+  // What the overlay shows, and when it was last worked out.
+  PacingReport shown;
+  double shownAt;
+} Pacing;
+
+// `refresh` is the display's refresh period in seconds, 0 when it is not known.
+void StartPacing(Pacing *pacing, double refresh);
+// Called first thing in every frame with the time and the pointer position just polled.
+void PacingFrame(Pacing *pacing, double now, float pointerX, float pointerY);
+// Called when the grabbed point of a dragged card is drawn at (x, y) in this frame.
+void PacingDragDrawn(Pacing *pacing, float x, float y);
+PacingReport ReadPacing(const Pacing *pacing);
+// The report for the overlay, read again once it is PACING_REPORT_SECONDS old.
+const PacingReport *ShownPacing(Pacing *pacing, double now);
+
+#endif // PACING_H_
@@ -0,0 +1,30 @@
+#define _POSIX_C_SOURCE 199309L
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "platform.h"
+
+double NowSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+bool WriteAll(int fd, const void *data, size_t size) {
+  const char *bytes = data;
+  while (size > 0) {
+    ssize_t n = write(fd, bytes, size);
+    if (n < 0) return false;
+    bytes += n;
+    size -= n;
+  }
+  return true;
+}
+
+void RaiseFileLimit(void) {
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+}
@@ -0,0 +1,16 @@
+#ifndef PLATFORM_H_
+#define PLATFORM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// The few calls into the operating system that more than one tool makes.
+
+// Seconds on the monotonic clock, for timing intervals.
+double NowSeconds(void);
+// Writes all of `data` to `fd`, carrying on after short writes. False on an error.
+bool WriteAll(int fd, const void *data, size_t size);
+// Raises the open file limit to the hard limit, for the tools that hold thousands of sockets.
+void RaiseFileLimit(void);
+
+#endif // PLATFORM_H_
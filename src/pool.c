@@ -0,0 +1,54 @@
+#include <stdlib.h>
+
+#include "pool.h"
+#include "../nob.h"
+
+void InitPool(Pool *pool, size_t slotSize, size_t slabSlots) {
+  *pool = (Pool) {0};
+  if (slotSize < sizeof(void*)) slotSize = sizeof(void*);
+  pool->slotSize = (slotSize + POOL_ALIGNMENT - 1) / POOL_ALIGNMENT * POOL_ALIGNMENT;
+  pool->slabSlots = slabSlots > 0 ? slabSlots : 1;
+}
+
+void FreePool(Pool *pool) {
+  for (size_t s = 0; s < pool->slabs.count; ++s) free(pool->slabs.items[s]);
+  nob_da_free(pool->slabs);
+  *pool = (Pool) {0};
+}
+
+// Threads a new slab onto the free list, first slot first.
+static bool AddSlab(Pool *pool) {
+  char *slab = aligned_alloc(POOL_ALIGNMENT, pool->slotSize*pool->slabSlots);
+  if (!slab) {
+    nob_log(NOB_ERROR, "Could not allocate a slab of %zu slots", pool->slabSlots);
+    return false;
+  }
+  nob_da_append(&pool->slabs, slab);
+  for (size_t s = pool->slabSlots; s-- > 0;) {
+    void *slot = slab + s*pool->slotSize;
+    *(void**)slot = pool->free;
+    pool->free = slot;
+  }
+  return true;
+}
+
+bool ReservePool(Pool *pool, size_t slots) {
+  while (pool->slabs.count*pool->slabSlots < slots) {
+    if (!AddSlab(pool)) return false;
+  }
+  return true;
+}
+
+void *TakeSlot(Pool *pool) {
+  if (!pool->free && !AddSlab(pool)) return NULL;
+  void *slot = pool->free;
+  pool->free = *(void**)slot;
+  pool->taken++;
+  return slot;
+}
+
+void GiveSlot(Pool *pool, void *slot) {
+  *(void**)slot = pool->free;
+  pool->free = slot;
+  pool->taken--;
+}
@@ -0,0 +1,38 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// A pool hands out fixed-size slots carved from large slabs. A slot that is given back goes on a
+// free list threaded through the slots themselves and is the next one taken, so once the pool has
+// grown to its working size taking and giving slots never touches the allocator. Slabs are only
+// freed with the pool, which keeps every slot at the same address for as long as it is taken.
+// Slots are rounded up to a cache line so two of them never share one.
+
+#define POOL_ALIGNMENT 64
+
+typedef struct {
+  void **items;
+  size_t count;
+  size_t capacity;
+} PoolSlabs;
+
+typedef struct {
+  size_t slotSize;
+  size_t slabSlots;
+  PoolSlabs slabs;
+  void *free;
+  size_t taken;
+} Pool;
+
+void InitPool(Pool *pool, size_t slotSize, size_t slabSlots);
+void FreePool(Pool *pool);
+// Grows the pool until it holds at least `slots` slots without allocating again.
+bool ReservePool(Pool *pool, size_t slots);
+// A slot holds whatever was left in it, so the caller sets every field it uses. NULL only when a
+// new slab cannot be allocated.
+void *TakeSlot(Pool *pool);
+void GiveSlot(Pool *pool, void *slot);
+
+#endif // POOL_H_
@@ -0,0 +1,99 @@
+#include <string.h>
+
+#include "prefetch.h"
+#include "../nob.h"
+
+static void *PrefetchWorker(void *arg) {
+  Prefetcher *prefetcher = arg;
+  PreparedDeal *deal = &prefetcher->scratch;
+  pthread_mutex_lock(&prefetcher->mutex);
+  while (prefetcher->running) {
+    if (prefetcher->ready) {
+      pthread_cond_wait(&prefetcher->wake, &prefetcher->mutex);
+      continue;
+    }
+    deal->variant = prefetcher->variant;
+    deal->drawCount = prefetcher->drawCount;
+    pthread_mutex_unlock(&prefetcher->mutex);
+
+    deal->count = FillShoe(deal->order, variants[deal->variant].decks);
+    ShuffleCardIds(deal->order, deal->count, &prefetcher->random);
+    bool dealt = DealBoard(&deal->board, deal->variant, deal->order, deal->count, deal->drawCount);
+    if (dealt) {
+      Board board = deal->board;
+      SolveLimits limits = { .seconds = PREFETCH_SOLVE_SECONDS };
+      deal->verdict = Solve(&prefetcher->solver, &board, limits, &prefetcher->solution);
+      if (prefetcher->nodes) CountStat(prefetcher->nodes, prefetcher->solution.nodes);
+    }
+
+    pthread_mutex_lock(&prefetcher->mutex);
+    // A deal that was asked for while this one was being prepared replaces it.
+    if (dealt && deal->variant == prefetcher->variant && deal->drawCount == prefetcher->drawCount) {
+      prefetcher->deal = *deal;
+      prefetcher->ready = true;
+    } else if (!dealt) {
+      nob_log(NOB_ERROR, "Could not prefetch a deal of variant %d", deal->variant);
+      prefetcher->ready = true;
+      prefetcher->deal.count = 0;
+    }
+  }
+  pthread_mutex_unlock(&prefetcher->mutex);
+  return NULL;
+}
+
+bool StartPrefetcher(Prefetcher *prefetcher, uint64_t seed, _Atomic uint64_t *nodes) {
+  memset(prefetcher, 0, sizeof(*prefetcher));
+  prefetcher->random = seed;
+  prefetcher->nodes = nodes;
+  // Nothing is prepared until the first deal is asked for.
+  prefetcher->ready = true;
+  if (!InitSolver(&prefetcher->solver, PREFETCH_TABLE_BITS)) return false;
+  pthread_mutex_init(&prefetcher->mutex, NULL);
+  pthread_cond_init(&prefetcher->wake, NULL);
+  prefetcher->running = true;
+  if (pthread_create(&prefetcher->thread, NULL, PrefetchWorker, prefetcher) != 0) {
+    nob_log(NOB_ERROR, "Could not start the prefetch worker");
+    prefetcher->running = false;
+    FreeSolver(&prefetcher->solver);
+    return false;
+  }
+  return true;
+}
+
+void StopPrefetcher(Prefetcher *prefetcher) {
+  if (!prefetcher->running) return;
+  pthread_mutex_lock(&prefetcher->mutex);
+  prefetcher->running = false;
+  pthread_cond_signal(&prefetcher->wake);
+  pthread_mutex_unlock(&prefetcher->mutex);
+  pthread_join(prefetcher->thread, NULL);
+  pthread_mutex_destroy(&prefetcher->mutex);
+  pthread_cond_destroy(&prefetcher->wake);
+  FreeSolver(&prefetcher->solver);
+}
+
+void PrefetchDeal(Prefetcher *prefetcher, VariantKind variant, size_t drawCount) {
+  pthread_mutex_lock(&prefetcher->mutex);
+  bool same = prefetcher->variant == variant && prefetcher->drawCount == drawCount;
+  if (!same || (prefetcher->ready && prefetcher->deal.count == 0)) {
+    prefetcher->variant = variant;
+    prefetcher->drawCount = drawCount;
+    prefetcher->ready = false;
+    pthread_cond_signal(&prefetcher->wake);
+  }
+  pthread_mutex_unlock(&prefetcher->mutex);
+}
+
+bool TakePreparedDeal(Prefetcher *prefetcher, VariantKind variant, size_t drawCount, PreparedDeal *deal) {
+  pthread_mutex_lock(&prefetcher->mutex);
+  bool taken = prefetcher->ready && prefetcher->deal.count > 0
+    && prefetcher->variant == variant && prefetcher->drawCount == drawCount;
+  if (taken) {
+    *deal = prefetcher->deal;
+    prefetcher->deal.count = 0;
+    prefetcher->ready = false;
+    pthread_cond_signal(&prefetcher->wake);
+  }
+  pthread_mutex_unlock(&prefetcher->mutex);
+  return taken;
+}
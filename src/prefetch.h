@@ -0,0 +1,60 @@
+#ifndef PREFETCH_H_
+#define PREFETCH_H_
+
+#include <pthread.h>
+
+#include "solver.h"
+#include "stats.h"
+
+// The next deal is shuffled, dealt and given a quick look by the solver on a worker thread while
+// the current game is played, so starting a new game only copies a finished board over. One deal
+// is kept ready at a time, for the variant and draw count last asked for.
+
+#define PREFETCH_SOLVE_SECONDS 0.1
+// The search stops once the visited table is three quarters full, so the table has to outlast the
+// budget or the verdict says more about its size than about the deal: 2^20 entries hold the 0.1 s
+// of a solver running at up to about 7M positions per second.
+#define PREFETCH_TABLE_BITS 20
+
+typedef struct {
+  VariantKind variant;
+  size_t drawCount;
+  CardId order[MAX_CARDS];
+  size_t count;
+  Board board;
+  // What the solver made of the deal in its budget; SOLVE_UNKNOWN when it ran out.
+  SolveResult verdict;
+} PreparedDeal;
+
+typedef struct {
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t wake;
+  bool running;
+
+  // The deal wanted next; `ready` once `deal` holds it.
+  VariantKind variant;
+  size_t drawCount;
+  bool ready;
+  PreparedDeal deal;
+
+  // Only the worker touches these.
+  uint64_t random;
+  PreparedDeal scratch;
+  Solver solver;
+  Solution solution;
+  _Atomic uint64_t *nodes;
+} Prefetcher;
+
+// Shuffles from its own random state, seeded with `seed`. Nodes searched are counted into `nodes`
+// when it is set.
+bool StartPrefetcher(Prefetcher *prefetcher, uint64_t seed, _Atomic uint64_t *nodes);
+void StopPrefetcher(Prefetcher *prefetcher);
+// Asks for a deal of `variant`; a ready deal of another variant is thrown away. Never blocks on
+// the worker.
+void PrefetchDeal(Prefetcher *prefetcher, VariantKind variant, size_t drawCount);
+// Hands over the ready deal when it is of `variant` and `drawCount` and starts on the next one.
+// False when none is ready yet.
+bool TakePreparedDeal(Prefetcher *prefetcher, VariantKind variant, size_t drawCount, PreparedDeal *deal);
+
+#endif // PREFETCH_H_
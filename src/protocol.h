@@ -0,0 +1,46 @@
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include "engine.h"
+
+// The wire format between the game server and its clients. Every connection is one session with
+// one game. The client sends fixed-size requests and the server answers each one with a
+// response header followed by the legal moves of the session's position, so a client never has
+// to know the rules. Both ends run on the same machine, so fields go in host byte order.
+
+#define SERVER_SOCKET "/tmp/ccards.sock"
+
+typedef enum {
+  OP_NEW,    // deal `variant` from `seed`
+  OP_MOVE,   // play `move`
+  OP_STATE,  // only ask for the moves again
+  OP_COUNT
+} Op;
+
+typedef enum {
+  STATUS_OK,
+  STATUS_ILLEGAL,  // the move was not legal; the position is unchanged
+  STATUS_NO_GAME,  // a move came before any deal
+  STATUS_BAD_REQUEST,
+} Status;
+
+typedef struct {
+  uint8_t op;
+  uint8_t variant;
+  uint8_t drawCount;
+  uint8_t reserved;
+  Move move;
+  uint64_t seed;
+} Request;
+
+typedef struct {
+  uint8_t status;
+  uint8_t won;
+  uint16_t moveCount;
+  uint32_t plies;
+} ResponseHeader;
+
+// The most a response can take: the header and every move.
+#define RESPONSE_MAX (sizeof(ResponseHeader) + MAX_MOVES*sizeof(Move))
+
+#endif // PROTOCOL_H_
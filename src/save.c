@@ -0,0 +1,73 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "save.h"
+#include "platform.h"
+#include "../nob.h"
+
+// Both are written as they are in memory, so their layout is the file format.
+_Static_assert(sizeof(SaveHeader) == 16 + MAX_CARDS, "SaveHeader has padding");
+_Static_assert(sizeof(Move) == 4, "Move has padding");
+
+bool BeginSave(SaveFile *save, const char *path, SaveHeader header, const MoveJournal *journal) {
+  memcpy(header.magic, SAVE_MAGIC, sizeof(header.magic));
+  header.version = SAVE_VERSION;
+  save->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (save->fd < 0) {
+    nob_log(NOB_ERROR, "Could not open save file %s: %s", path, strerror(errno));
+    return false;
+  }
+  // The header and the journal go out in one write.
+  Nob_String_Builder sb = {0};
+  nob_sb_append_buf(&sb, &header, sizeof(header));
+  if (journal) nob_sb_append_buf(&sb, journal->items, journal->count*sizeof(Move));
+  bool ok = WriteAll(save->fd, sb.items, sb.count);
+  nob_sb_free(sb);
+  if (!ok) {
+    nob_log(NOB_ERROR, "Could not write save file %s: %s", path, strerror(errno));
+    CloseSave(save);
+  }
+  return ok;
+}
+
+bool AppendMove(SaveFile *save, Move move) {
+  if (save->fd < 0) return false;
+  if (!WriteAll(save->fd, &move, sizeof(move))) {
+    nob_log(NOB_ERROR, "Could not append to the save file: %s", strerror(errno));
+    CloseSave(save);
+    return false;
+  }
+  return true;
+}
+
+void CloseSave(SaveFile *save) {
+  if (save->fd >= 0) close(save->fd);
+  save->fd = -1;
+}
+
+bool LoadSave(const char *path, SaveHeader *header, MoveJournal *journal) {
+  journal->count = 0;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(*header);
+  char *data = ok ? malloc(st.st_size) : NULL;
+  ok = ok && data && read(fd, data, st.st_size) == st.st_size;
+  close(fd);
+  if (ok) {
+    memcpy(header, data, sizeof(*header));
+    ok = memcmp(header->magic, SAVE_MAGIC, sizeof(header->magic)) == 0 && header->version == SAVE_VERSION;
+    if (!ok) nob_log(NOB_WARNING, "Ignoring save file %s from another version", path);
+  }
+  if (ok) {
+    size_t count = (st.st_size - sizeof(*header))/sizeof(Move);
+    nob_da_reserve(journal, count);
+    memcpy(journal->items, data + sizeof(*header), count*sizeof(Move));
+    journal->count = count;
+  }
+  free(data);
+  return ok;
+}
@@ -0,0 +1,45 @@
+#ifndef SAVE_H_
+#define SAVE_H_
+
+#include "engine.h"
+
+// A save is the deal's card order followed by a journal of the moves the player made, in the
+// order they were made. The file is only ever appended to, one small write per move, so saving
+// costs next to nothing and a crash loses at most the move that was being written. Resuming reads
+// the whole file at once and plays the journal back on a fresh deal.
+
+#define SAVE_MAGIC "CCSV"
+// Version 2 stores the card order instead of a seed, so deals that did not come from a seed (the
+// deal file) can be saved too.
+#define SAVE_VERSION 2
+
+typedef struct {
+  char magic[4];
+  uint16_t version;
+  uint8_t variant;
+  uint8_t drawCount;
+  uint8_t cardCount;
+  uint8_t reserved[7];
+  CardId order[MAX_CARDS];
+} SaveHeader;
+
+typedef struct {
+  Move *items;
+  size_t count;
+  size_t capacity;
+} MoveJournal;
+
+typedef struct {
+  int fd;  // -1 when nothing is being saved
+} SaveFile;
+
+// Starts the file over with `header` and the moves already in `journal`, then keeps it open for
+// AppendMove.
+bool BeginSave(SaveFile *save, const char *path, SaveHeader header, const MoveJournal *journal);
+bool AppendMove(SaveFile *save, Move move);
+void CloseSave(SaveFile *save);
+// Fails when there is no save or it is from another version. A move cut short by a crash is
+// dropped from the end of the journal.
+bool LoadSave(const char *path, SaveHeader *header, MoveJournal *journal);
+
+#endif // SAVE_H_
@@ -0,0 +1,274 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define NOB_IMPLEMENTATION
+#include "../nob.h"
+
+#include "engine.h"
+#include "pool.h"
+#include "protocol.h"
+#include "platform.h"
+
+// Hosts many solitaire sessions on one thread with an epoll loop:
+//
+//   ./build/server [socket path | port]
+//
+// A port number listens on loopback TCP, anything else is a Unix socket path (SERVER_SOCKET by
+// default). Every connection is a session whose whole state, the packed board included, is one
+// slot of a slab pool, so once the pool has grown to the number of sessions being hosted accepting
+// and dropping sessions never allocates. Every few seconds the server reports its sessions,
+// requests per second and how much of a core it used.
+
+#define SERVER_MAX_SESSIONS 16384
+#define SERVER_SLAB_SESSIONS 1024
+#define SERVER_MAX_EVENTS 256
+#define SERVER_REPORT_SECONDS 5.0
+
+typedef struct {
+  int fd;
+  bool hasGame;
+  uint32_t plies;
+  Board board;
+  uint8_t in[sizeof(Request)];
+  size_t inCount;
+  uint8_t out[RESPONSE_MAX];
+  size_t outCount;
+  size_t outSent;
+  // Whether epoll is waiting for the socket to take more output rather than for input.
+  bool writing;
+} Session;
+
+static Session *TakeSession(Pool *pool) {
+  if (pool->taken >= SERVER_MAX_SESSIONS) return NULL;
+  Session *session = TakeSlot(pool);
+  if (!session) return NULL;
+  session->hasGame = false;
+  session->plies = 0;
+  session->inCount = 0;
+  session->outCount = 0;
+  session->outSent = 0;
+  session->writing = false;
+  return session;
+}
+
+static volatile sig_atomic_t stopping = false;
+
+static void Stop(int signal) {
+  NOB_UNUSED(signal);
+  stopping = true;
+}
+
+static double CpuSeconds(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec)*1e-6;
+}
+
+static bool SetNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool IsPort(const char *where) {
+  char *end;
+  strtol(where, &end, 10);
+  return *where != '\0' && *end == '\0';
+}
+
+static int Listen(const char *where) {
+  int fd;
+  if (IsPort(where)) {
+    long port = strtol(where, NULL, 10);
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0) fd = -1;
+  } else {
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strncpy(address.sun_path, where, sizeof(address.sun_path) - 1);
+    unlink(where);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0) fd = -1;
+  }
+  if (fd < 0 || listen(fd, SOMAXCONN) != 0 || !SetNonBlocking(fd)) {
+    nob_log(NOB_ERROR, "Could not listen on %s: %s", where, strerror(errno));
+    return -1;
+  }
+  return fd;
+}
+
+// Runs one request against the session's board and writes the response into its output buffer.
+static void Handle(Session *session, const Request *request) {
+  Status status = STATUS_OK;
+  switch (request->op) {
+    case OP_NEW:
+      if (request->variant >= VARIANT_COUNT || !DealSeed(&session->board, request->variant, request->seed, request->drawCount)) {
+        status = STATUS_BAD_REQUEST;
+        break;
+      }
+      session->hasGame = true;
+      session->plies = 0;
+      break;
+    case OP_MOVE: {
+      if (!session->hasGame) {
+        status = STATUS_NO_GAME;
+        break;
+      }
+      if (!IsMoveLegal(&session->board, request->move)) {
+        status = STATUS_ILLEGAL;
+        break;
+      }
+      Board *board = &session->board;
+      ApplyMove(board, request->move);
+      Move run;
+      while (FindCompletedRun(board, &run)) ApplyMove(board, run);
+      if (CanAutoComplete(board)) {
+        static Move rest[AUTO_COMPLETE_MAX_MOVES];
+        AutoComplete(board, rest);
+      }
+      session->plies++;
+    } break;
+    case OP_STATE:
+      if (!session->hasGame) status = STATUS_NO_GAME;
+      break;
+    default:
+      status = STATUS_BAD_REQUEST;
+      break;
+  }
+
+  ResponseHeader header = { .status = status, .plies = session->plies };
+  size_t moveCount = 0;
+  if (session->hasGame) {
+    header.won = IsBoardWon(&session->board);
+    moveCount = GenerateMoves(&session->board, (Move*)(session->out + sizeof(header)));
+  }
+  header.moveCount = moveCount;
+  memcpy(session->out, &header, sizeof(header));
+  session->outCount = sizeof(header) + moveCount*sizeof(Move);
+  session->outSent = 0;
+}
+
+// Writes what it can of the pending response. False when the connection is gone.
+static bool SendPending(Session *session) {
+  while (session->outSent < session->outCount) {
+    ssize_t n = write(session->fd, session->out + session->outSent, session->outCount - session->outSent);
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+    session->outSent += n;
+  }
+  return true;
+}
+
+static bool Pending(const Session *session) {
+  return session->outSent < session->outCount;
+}
+
+// Reads and answers requests until the socket runs dry or a response cannot be sent whole. A
+// session with a response still going out reads nothing more, so a slow client only slows itself.
+static bool Serve(Session *session, size_t *requests) {
+  while (!Pending(session)) {
+    ssize_t n = read(session->fd, session->in + session->inCount, sizeof(Request) - session->inCount);
+    if (n == 0) return false;
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+    session->inCount += n;
+    if (session->inCount < sizeof(Request)) continue;
+    Request request;
+    memcpy(&request, session->in, sizeof(request));
+    session->inCount = 0;
+    Handle(session, &request);
+    (*requests)++;
+    if (!SendPending(session)) return false;
+  }
+  return true;
+}
+
+// Only touches epoll when the session switches between waiting to read and waiting to write.
+static void Watch(int epoll, Session *session) {
+  if (Pending(session) == session->writing) return;
+  session->writing = Pending(session);
+  struct epoll_event event = { .events = session->writing ? EPOLLOUT : EPOLLIN, .data.ptr = session };
+  epoll_ctl(epoll, EPOLL_CTL_MOD, session->fd, &event);
+}
+
+int main(int argc, char **argv) {
+  const char *where = argc > 1 ? argv[1] : SERVER_SOCKET;
+  // Thousands of sessions need more descriptors than the usual soft limit.
+  RaiseFileLimit();
+  signal(SIGINT, Stop);
+  signal(SIGTERM, Stop);
+  signal(SIGPIPE, SIG_IGN);
+
+  Pool pool;
+  InitPool(&pool, sizeof(Session), SERVER_SLAB_SESSIONS);
+  if (!ReservePool(&pool, SERVER_SLAB_SESSIONS)) return 1;
+  int listener = Listen(where);
+  if (listener < 0) return 1;
+  int epoll = epoll_create1(0);
+  // The listener is told apart from sessions by having no session.
+  struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+  epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+  nob_log(NOB_INFO, "Serving on %s", where);
+
+  struct epoll_event events[SERVER_MAX_EVENTS];
+  size_t requests = 0;
+  double reportedAt = NowSeconds();
+  double cpuAt = CpuSeconds();
+  while (!stopping) {
+    int n = epoll_wait(epoll, events, SERVER_MAX_EVENTS, 1000);
+    for (int e = 0; e < n; ++e) {
+      Session *session = events[e].data.ptr;
+      if (!session) {
+        int fd;
+        while ((fd = accept(listener, NULL, NULL)) >= 0) {
+          Session *taken = TakeSession(&pool);
+          if (!taken || !SetNonBlocking(fd)) {
+            if (taken) GiveSlot(&pool, taken);
+            close(fd);
+            continue;
+          }
+          taken->fd = fd;
+          struct epoll_event watch = { .events = EPOLLIN, .data.ptr = taken };
+          epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &watch);
+        }
+        continue;
+      }
+      bool open = !(events[e].events & (EPOLLERR | EPOLLHUP)) || (events[e].events & EPOLLIN);
+      if (open && (events[e].events & EPOLLOUT)) open = SendPending(session);
+      if (open) open = Serve(session, &requests);
+      if (open) {
+        Watch(epoll, session);
+      } else {
+        epoll_ctl(epoll, EPOLL_CTL_DEL, session->fd, NULL);
+        close(session->fd);
+        GiveSlot(&pool, session);
+      }
+    }
+
+    double now = NowSeconds();
+    if (now - reportedAt >= SERVER_REPORT_SECONDS) {
+      double cpu = CpuSeconds();
+      printf("server: %zu sessions, %.0f requests/s, %.0f%% of a core\n",
+             pool.taken, requests/(now - reportedAt), 100*(cpu - cpuAt)/(now - reportedAt));
+      fflush(stdout);
+      requests = 0;
+      reportedAt = now;
+      cpuAt = cpu;
+    }
+  }
+
+  close(listener);
+  close(epoll);
+  FreePool(&pool);
+  if (!IsPort(where)) unlink(where);
+  return 0;
+}
@@ -0,0 +1,180 @@
+#define _POSIX_C_SOURCE 199309L
+#include <string.h>
+
+#include "solver.h"
+#include "platform.h"
+#include "../nob.h"
+
+bool InitSolver(Solver *solver, size_t tableBits) {
+  memset(solver, 0, sizeof(*solver));
+  solver->table = calloc((size_t)1 << tableBits, sizeof(*solver->table));
+  solver->moves = malloc(SOLVE_MAX_DEPTH * sizeof(*solver->moves));
+  if (!solver->table || !solver->moves) {
+    nob_log(NOB_ERROR, "Could not allocate solver tables");
+    FreeSolver(solver);
+    return false;
+  }
+  solver->tableMask = ((size_t)1 << tableBits) - 1;
+  return true;
+}
+
+void FreeSolver(Solver *solver) {
+  free(solver->table);
+  free(solver->moves);
+  solver->table = NULL;
+  solver->moves = NULL;
+}
+
+// Returns false when the position was already visited. 0 marks an empty slot, so a zero hash is
+// nudged to 1.
+static bool Visit(Solver *solver, uint64_t hash) {
+  if (hash == 0) hash = 1;
+  size_t i = hash & solver->tableMask;
+  while (solver->table[i] != 0) {
+    if (solver->table[i] == hash) return false;
+    i = (i + 1) & solver->tableMask;
+  }
+  solver->table[i] = hash;
+  solver->tableCount++;
+  return true;
+}
+
+// Progress used to pick the best partial line when the budget runs out.
+static int ScoreBoard(const Board *board) {
+  const Variant *variant = BoardVariant(board);
+  int score = 0;
+  for (size_t f = 0; f < variant->foundations; ++f) score += 10*board->piles[PILE_FOUNDATION + f].count;
+  for (size_t c = 0; c < variant->cells; ++c) score -= 3*board->piles[PILE_CELL + c].count;
+  for (size_t t = 0; t < variant->tableau; ++t) {
+    score -= 6*board->piles[PILE_TABLEAU + t].hidden;
+    if (board->piles[PILE_TABLEAU + t].count == 0) score += 2;
+  }
+  return score;
+}
+
+// A card can go up safely when nothing of the other color could still need it as a target. A
+// finished Spider run is never needed again.
+static bool IsSafeToFound(const Board *board, Move move) {
+  if (BoardVariant(board)->foundation == FOUND_RUN) return true;
+  PileView src = ViewPile(board, move.from);
+  CardId card = src.cards[src.count-1];
+  Value value = CardIdValue(card);
+  if (value <= VAL_TWO) return true;
+  bool red = CardIdIsRed(card);
+  for (size_t s = 0; s < SUIT_COUNT; ++s) {
+    bool otherRed = s == SUIT_DIAMONDS || s == SUIT_HEARTS;
+    if (otherRed != red && board->piles[PILE_FOUNDATION + s].count < value - 1) return false;
+  }
+  return true;
+}
+
+static int MovePriority(const Board *board, Move move) {
+  switch (move.kind) {
+    case MOVE_DRAW:    return 30;
+    case MOVE_DEAL:    return 25;
+    case MOVE_RECYCLE: return 20;
+    default: break;
+  }
+  PileView src = ViewPile(board, move.from);
+  if (IsFoundation(move.to)) return 90 + (IsTableau(move.from) && src.hidden > 0 && src.count == src.hidden + 1);
+  if (IsFoundation(move.from)) return 5;
+  if (move.from == PILE_WASTE || IsCell(move.from)) return 50;
+  if (IsCell(move.to)) return 8;
+  // Tableau to tableau: worth it when it uncovers a card or empties the file.
+  if (move.count == src.count - src.hidden) return src.hidden > 0 ? 80 + (int)src.hidden : 60;
+  return 10;
+}
+
+static void OrderMoves(const Board *board, Move *moves, size_t n) {
+  int priority[MAX_MOVES];
+  for (size_t i = 0; i < n; ++i) priority[i] = MovePriority(board, moves[i]);
+  for (size_t i = 1; i < n; ++i) {
+    Move m = moves[i];
+    int p = priority[i];
+    size_t j = i;
+    while (j > 0 && priority[j-1] < p) {
+      moves[j] = moves[j-1];
+      priority[j] = priority[j-1];
+      j--;
+    }
+    moves[j] = m;
+    priority[j] = p;
+  }
+}
+
+static void RecordLine(Solver *solver, size_t depth) {
+  memcpy(solver->out->moves, solver->path, depth*sizeof(Move));
+  solver->out->count = depth;
+}
+
+static bool Search(Solver *solver, const Board *board, size_t depth) {
+  if (CanAutoComplete(board) || IsBoardWon(board)) {
+    RecordLine(solver, depth);
+    Board rest = *board;
+    solver->out->count += AutoComplete(&rest, &solver->out->moves[depth]);
+    return true;
+  }
+
+  solver->nodes++;
+  if ((solver->nodes & 1023) == 0 && solver->deadline > 0 && NowSeconds() > solver->deadline) solver->stopped = true;
+  if (solver->maxNodes > 0 && solver->nodes >= solver->maxNodes) solver->stopped = true;
+  if (solver->stopped) return false;
+  if (depth >= SOLVE_MAX_DEPTH || solver->tableCount > solver->tableMask/4*3) {
+    solver->truncated = true;
+    return false;
+  }
+  if (!Visit(solver, HashBoard(board))) return false;
+
+  int score = ScoreBoard(board);
+  if (score > solver->bestScore) {
+    solver->bestScore = score;
+    RecordLine(solver, depth);
+  }
+
+  Move *moves = solver->moves[depth];
+  size_t n = GenerateMoves(board, moves);
+  solver->expanded++;
+  solver->branches += n;
+
+  // A safe move to the foundation can never hurt, so it is the only one worth trying.
+  for (size_t i = 0; i < n; ++i) {
+    if (moves[i].kind == MOVE_TRANSFER && IsFoundation(moves[i].to) && IsSafeToFound(board, moves[i])) {
+      moves[0] = moves[i];
+      n = 1;
+      break;
+    }
+  }
+  OrderMoves(board, moves, n);
+
+  for (size_t i = 0; i < n; ++i) {
+    Board child = *board;
+    ApplyMove(&child, moves[i]);
+    solver->path[depth] = moves[i];
+    if (Search(solver, &child, depth + 1)) return true;
+    if (solver->stopped) return false;
+  }
+  return false;
+}
+
+SolveResult Solve(Solver *solver, const Board *board, SolveLimits limits, Solution *out) {
+  memset(solver->table, 0, (solver->tableMask + 1)*sizeof(*solver->table));
+  solver->tableCount = 0;
+  solver->bestScore = -1000000;
+  solver->nodes = 0;
+  solver->expanded = 0;
+  solver->branches = 0;
+  solver->maxNodes = limits.maxNodes;
+  solver->deadline = limits.seconds > 0 ? NowSeconds() + limits.seconds : 0;
+  solver->stopped = false;
+  solver->truncated = false;
+  solver->out = out;
+  out->count = 0;
+
+  if (Search(solver, board, 0)) out->result = SOLVE_WON;
+  else if (solver->stopped || solver->truncated) out->result = SOLVE_UNKNOWN;
+  else out->result = SOLVE_LOST;
+
+  out->nodes = solver->nodes;
+  out->branching = solver->expanded > 0 ? (double)solver->branches/solver->expanded : 0;
+  return out->result;
+}
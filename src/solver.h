@@ -0,0 +1,57 @@
+#ifndef SOLVER_H_
+#define SOLVER_H_
+
+#include "engine.h"
+
+// Depth-first search over engine positions with a table of visited positions, a node budget and a
+// deadline. Used for hints and for rating deals; it never touches raylib.
+
+#define SOLVE_MAX_DEPTH 1024
+// Room for a full line: the searched part plus the auto-complete that finishes it.
+#define SOLVE_MAX_LINE (SOLVE_MAX_DEPTH + AUTO_COMPLETE_MAX_MOVES)
+
+typedef enum {
+  SOLVE_WON,
+  SOLVE_LOST,
+  SOLVE_UNKNOWN,
+} SolveResult;
+
+typedef struct {
+  size_t maxNodes;  // 0 for no limit
+  double seconds;   // wall clock budget, 0 for no limit
+} SolveLimits;
+
+typedef struct {
+  SolveResult result;
+  // The winning line when result is SOLVE_WON, otherwise the line to the most promising position
+  // the search reached.
+  Move moves[SOLVE_MAX_LINE];
+  size_t count;
+  size_t nodes;
+  // Average number of legal moves in the positions the search expanded.
+  double branching;
+} Solution;
+
+typedef struct {
+  uint64_t *table;
+  size_t tableMask;
+  size_t tableCount;
+  Move path[SOLVE_MAX_DEPTH];
+  Move (*moves)[MAX_MOVES];
+  int bestScore;
+  size_t nodes;
+  size_t expanded;
+  size_t branches;
+  size_t maxNodes;
+  double deadline;
+  bool stopped;
+  bool truncated;
+  Solution *out;
+} Solver;
+
+// The visited table holds 2^tableBits positions; a search that fills it reports SOLVE_UNKNOWN.
+bool InitSolver(Solver *solver, size_t tableBits);
+void FreeSolver(Solver *solver);
+SolveResult Solve(Solver *solver, const Board *board, SolveLimits limits, Solution *out);
+
+#endif // SOLVER_H_
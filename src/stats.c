@@ -0,0 +1,156 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "stats.h"
+#include "platform.h"
+#include "../nob.h"
+
+static uint64_t ReadStat(_Atomic uint64_t *counter) {
+  return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static void WriteStat(_Atomic uint64_t *counter, uint64_t value) {
+  atomic_store_explicit(counter, value, memory_order_relaxed);
+}
+
+void CountGame(Stats *stats, bool won) {
+  PlayerStats *player = &stats->player;
+  CountStat(&player->games, 1);
+  if (!won) {
+    WriteStat(&player->streak, 0);
+    return;
+  }
+  CountStat(&player->wins, 1);
+  uint64_t streak = ReadStat(&player->streak) + 1;
+  WriteStat(&player->streak, streak);
+  if (streak > ReadStat(&player->bestStreak)) WriteStat(&player->bestStreak, streak);
+}
+
+// The player's counters by the names they have in the file.
+typedef struct {
+  const char *name;
+  size_t offset;
+} PlayerField;
+
+static const PlayerField playerFields[] = {
+  { "games", offsetof(PlayerStats, games) },
+  { "wins", offsetof(PlayerStats, wins) },
+  { "microseconds", offsetof(PlayerStats, microseconds) },
+  { "moves", offsetof(PlayerStats, moves) },
+  { "streak", offsetof(PlayerStats, streak) },
+  { "best_streak", offsetof(PlayerStats, bestStreak) },
+};
+
+static _Atomic uint64_t *PlayerCounter(PlayerStats *player, const PlayerField *field) {
+  return (_Atomic uint64_t*)((char*)player + field->offset);
+}
+
+// Lines it does not know, the process rates among them, are skipped.
+static void LoadPlayer(PlayerStats *player, const char *path) {
+  Nob_String_Builder sb = {0};
+  if (access(path, F_OK) != 0 || !nob_read_entire_file(path, &sb)) return;
+  Nob_String_View rest = nob_sb_to_sv(sb);
+  while (rest.count > 0) {
+    Nob_String_View line = nob_sv_chop_by_delim(&rest, '\n');
+    Nob_String_View name = nob_sv_chop_by_delim(&line, ' ');
+    for (size_t f = 0; f < NOB_ARRAY_LEN(playerFields); ++f) {
+      if (!nob_sv_eq(name, nob_sv_from_cstr(playerFields[f].name))) continue;
+      char digits[32] = {0};
+      memcpy(digits, line.data, line.count < sizeof(digits) - 1 ? line.count : sizeof(digits) - 1);
+      WriteStat(PlayerCounter(player, &playerFields[f]), strtoull(digits, NULL, 10));
+    }
+  }
+  nob_sb_free(sb);
+}
+
+typedef struct {
+  uint64_t frames;
+  uint64_t moves;
+  uint64_t solverNodes;
+  double at;
+} ProcessSample;
+
+static ProcessSample SampleProcess(ProcessCounters *process) {
+  return (ProcessSample) {
+    .frames = ReadStat(&process->frames),
+    .moves = ReadStat(&process->moves),
+    .solverNodes = ReadStat(&process->solverNodes),
+    .at = NowSeconds(),
+  };
+}
+
+// Writes a file next to the old one and renames it over, so a crash mid-write never loses the
+// totals that were already there. The temporary allocator belongs to the frame loop, so nothing
+// here uses it.
+static bool Flush(Stats *stats, const ProcessSample *last, const ProcessSample *now) {
+  Nob_String_Builder sb = {0};
+  for (size_t f = 0; f < NOB_ARRAY_LEN(playerFields); ++f) {
+    nob_sb_appendf(&sb, "%s %" PRIu64 "\n", playerFields[f].name, ReadStat(PlayerCounter(&stats->player, &playerFields[f])));
+  }
+  double elapsed = now->at - last->at;
+  if (elapsed > 0) {
+    nob_sb_appendf(&sb, "frames_per_second %.1f\n", (now->frames - last->frames)/elapsed);
+    nob_sb_appendf(&sb, "moves_per_second %.1f\n", (now->moves - last->moves)/elapsed);
+    nob_sb_appendf(&sb, "solver_nodes_per_second %.0f\n", (now->solverNodes - last->solverNodes)/elapsed);
+  }
+  char temporary[4096];
+  snprintf(temporary, sizeof(temporary), "%s.tmp", stats->path);
+  bool ok = nob_write_entire_file(temporary, sb.items, sb.count);
+  if (ok && rename(temporary, stats->path) != 0) {
+    nob_log(NOB_ERROR, "Could not replace %s: %s", stats->path, strerror(errno));
+    ok = false;
+  }
+  nob_sb_free(sb);
+  return ok;
+}
+
+static void *StatsFlusher(void *arg) {
+  Stats *stats = arg;
+  ProcessSample last = SampleProcess(&stats->process);
+  pthread_mutex_lock(&stats->mutex);
+  while (stats->running) {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += STATS_FLUSH_SECONDS;
+    while (stats->running && pthread_cond_timedwait(&stats->wake, &stats->mutex, &until) != ETIMEDOUT) {}
+    pthread_mutex_unlock(&stats->mutex);
+    ProcessSample now = SampleProcess(&stats->process);
+    Flush(stats, &last, &now);
+    last = now;
+    pthread_mutex_lock(&stats->mutex);
+  }
+  pthread_mutex_unlock(&stats->mutex);
+  return NULL;
+}
+
+bool StartStats(Stats *stats, const char *path) {
+  memset(stats, 0, sizeof(*stats));
+  stats->path = path;
+  LoadPlayer(&stats->player, path);
+  pthread_mutex_init(&stats->mutex, NULL);
+  pthread_cond_init(&stats->wake, NULL);
+  stats->running = true;
+  if (pthread_create(&stats->thread, NULL, StatsFlusher, stats) != 0) {
+    nob_log(NOB_ERROR, "Could not start the stats flusher");
+    stats->running = false;
+    return false;
+  }
+  return true;
+}
+
+void StopStats(Stats *stats) {
+  if (!stats->running) return;
+  pthread_mutex_lock(&stats->mutex);
+  stats->running = false;
+  pthread_cond_signal(&stats->wake);
+  pthread_mutex_unlock(&stats->mutex);
+  pthread_join(stats->thread, NULL);
+  pthread_mutex_destroy(&stats->mutex);
+  pthread_cond_destroy(&stats->wake);
+}
@@ -0,0 +1,61 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Statistics are plain atomic counters bumped with relaxed adds, so counting costs the frame loop
+// and the solver workers one uncontended instruction and never a lock. A thread of its own reads
+// them every few seconds and writes them out, so no one who counts ever waits for the disk.
+//
+// The player's totals are read back from the file at start and carried on from there. The process
+// counters only live as long as the process; the file shows their rates over the last period.
+
+#define STATS_PATH "ccards.stats"
+#define STATS_FLUSH_SECONDS 5
+
+typedef struct {
+  _Atomic uint64_t games;
+  _Atomic uint64_t wins;
+  _Atomic uint64_t microseconds;
+  _Atomic uint64_t moves;
+  // Games won in a row, ending with the last one finished.
+  _Atomic uint64_t streak;
+  _Atomic uint64_t bestStreak;
+} PlayerStats;
+
+// The frame loop's counters and the workers' are kept on cache lines of their own, so counting on
+// one side never stalls the other.
+typedef struct {
+  _Alignas(64) _Atomic uint64_t frames;
+  _Atomic uint64_t moves;
+  _Alignas(64) _Atomic uint64_t solverNodes;
+} ProcessCounters;
+
+typedef struct {
+  PlayerStats player;
+  ProcessCounters process;
+
+  const char *path;
+  pthread_t thread;
+  // Only the flush thread and StopStats take these, to sleep and to be woken for the last flush.
+  pthread_mutex_t mutex;
+  pthread_cond_t wake;
+  bool running;
+} Stats;
+
+// Loads the player's totals from `path` when it exists and starts the flush thread.
+bool StartStats(Stats *stats, const char *path);
+// Writes the counters out one last time and stops the flush thread.
+void StopStats(Stats *stats);
+// Counts a finished game, won or given up, into the totals and the streak. Only ever called from
+// one thread, so the streak needs no compare-and-swap.
+void CountGame(Stats *stats, bool won);
+
+static inline void CountStat(_Atomic uint64_t *counter, uint64_t amount) {
+  atomic_fetch_add_explicit(counter, amount, memory_order_relaxed);
+}
+
+#endif // STATS_H_